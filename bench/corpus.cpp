@@ -0,0 +1,257 @@
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "corpus.h"
+
+namespace {
+
+// splitmix64: tiny, fast and the same everywhere.
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, n), n > 0.
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+
+    bool chance(double p) { return static_cast<double>(next() >> 11) * 0x1.0p-53 < p; }
+
+private:
+    uint64_t state;
+};
+
+// A contract type together with what is needed to build a value of it.
+struct GenType {
+    enum Kind { Atomic, Nullable, Vector, DataFrame, Union, List, Class } kind;
+    std::string name;            // Atomic: type name; Class: the class names
+    std::vector<GenType> parts;  // Nullable, Vector, List: one; Union: two
+};
+
+const char* const atomicNames[] = {"numeric", "integer", "double", "character", "logical"};
+
+GenType atomicType(Random& random) {
+    return {GenType::Atomic, atomicNames[random.below(5)], {}};
+}
+
+GenType randomType(Random& random, int complexity, int level) {
+    // Kinds available at each complexity, the simpler ones more likely.
+    size_t kinds = complexity <= 0 ? 1 : complexity == 1 ? 4 : complexity == 2 ? 6 : 7;
+    size_t pick = random.below(kinds + 2);
+    if (pick >= kinds || level >= 2)
+        return atomicType(random);
+
+    switch (static_cast<GenType::Kind>(pick)) {
+    case GenType::Nullable:
+        return {GenType::Nullable, "", {atomicType(random)}};
+    case GenType::Vector: {
+        GenType base = atomicType(random);
+        if (random.chance(0.25))
+            base = {GenType::Nullable, "", {base}};
+        return {GenType::Vector, "", {base}};
+    }
+    case GenType::DataFrame:
+        return {GenType::DataFrame, "", {}};
+    case GenType::Union: {
+        GenType left = randomType(random, complexity, level + 1);
+        GenType right = randomType(random, complexity, level + 1);
+        // The contract parser only continues a union after a plain,
+        // nullable or vector type, so list<> and class<> go on the right.
+        while (left.kind == GenType::Union || left.kind == GenType::List || left.kind == GenType::Class)
+            left = atomicType(random);
+        while (right.kind == GenType::Union)
+            right = atomicType(random);
+        return {GenType::Union, "", {left, right}};
+    }
+    case GenType::List:
+        return {GenType::List, "", {randomType(random, complexity, level + 1)}};
+    case GenType::Class: {
+        std::string first = "s3_" + std::to_string(random.below(8));
+        std::string second = "s3_" + std::to_string(8 + random.below(8));
+        return {GenType::Class, first + ", " + second, {}};
+    }
+    default:
+        return atomicType(random);
+    }
+}
+
+std::string typeString(const GenType& type) {
+    switch (type.kind) {
+    case GenType::Atomic: return type.name;
+    case GenType::Nullable: return typeString(type.parts[0]) + "?";
+    case GenType::Vector: return typeString(type.parts[0]) + "[]";
+    case GenType::DataFrame: return "dataframe";
+    case GenType::Union: return typeString(type.parts[0]) + " | " + typeString(type.parts[1]);
+    case GenType::List: return "list<" + typeString(type.parts[0]) + ">";
+    case GenType::Class: return "class<" + type.name + ">";
+    }
+    return "";
+}
+
+std::string atomicValue(Random& random, const std::string& name) {
+    std::string k = std::to_string(random.below(100));
+    if (name == "integer")
+        return k + "L";
+    if (name == "character")
+        return "\"s" + k + "\"";
+    if (name == "logical")
+        return random.chance(0.5) ? "TRUE" : "FALSE";
+    return k + ".5";
+}
+
+// An expression whose value passes the check of type.
+std::string valueString(Random& random, const GenType& type) {
+    switch (type.kind) {
+    case GenType::Atomic:
+        return atomicValue(random, type.name);
+    case GenType::Nullable:
+        return random.chance(0.3) ? "NULL" : valueString(random, type.parts[0]);
+    case GenType::Vector: {
+        const GenType& base = type.parts[0].kind == GenType::Nullable ? type.parts[0].parts[0] : type.parts[0];
+        std::string value = "c(" + atomicValue(random, base.name);
+        for (size_t i = random.below(4); i > 0; --i)
+            value += ", " + atomicValue(random, base.name);
+        return value + ")";
+    }
+    case GenType::DataFrame:
+        return "data.frame(a = 1:3, b = c(\"x\", \"y\", \"z\"))";
+    case GenType::Union:
+        return valueString(random, type.parts[random.below(2)]);
+    case GenType::List: {
+        // One element value, repeated, so that a static check can type it.
+        std::string element = valueString(random, type.parts[0]);
+        return "list(" + element + ", " + element + ")";
+    }
+    case GenType::Class:
+        return "structure(list(), class = \"" + type.name.substr(0, type.name.find(',')) + "\")";
+    }
+    return "NULL";
+}
+
+class Writer {
+public:
+    Writer(const CorpusOptions& options) : options(options), random(options.seed) {}
+
+    // Appends function number n and its call sites to text.
+    void function(uint64_t n, std::string& text) {
+        std::string name = "f" + std::to_string(n);
+        int arguments = options.arguments > 0 ? options.arguments : 1;
+        std::vector<GenType> types;
+        for (int i = 0; i < arguments; ++i)
+            types.push_back(randomType(random, options.complexity, 0));
+        size_t returned = random.below(types.size());
+
+        text += "# @contract " + name + " (";
+        for (size_t i = 0; i < types.size(); ++i)
+            text += (i ? ", " : "") + typeString(types[i]);
+        text += ") -> " + typeString(types[returned]) + "\n";
+
+        text += name + " <- function(";
+        for (size_t i = 0; i < types.size(); ++i)
+            text += (i ? ", a" : "a") + std::to_string(i + 1);
+        text += ") {\n";
+        std::string result = "a" + std::to_string(returned + 1);
+        line(1, "v <- length(a" + std::to_string(random.below(types.size()) + 1) + ")", text);
+        block(1, options.depth, result, text);
+        line(1, "return(" + result + ")", text);
+        text += "}\n";
+
+        for (int c = 0; c < options.calls; ++c) {
+            // Arguments are passed by position, or by name in reverse order.
+            bool named = random.chance(0.3);
+            std::string call = name + "(";
+            for (size_t k = 0; k < types.size(); ++k) {
+                size_t i = named ? types.size() - 1 - k : k;
+                call += k ? ", " : "";
+                if (named)
+                    call += "a" + std::to_string(i + 1) + " = ";
+                call += valueString(random, types[i]);
+            }
+            line(0, "r" + std::to_string(n) + "_" + std::to_string(c) + " <- " + call + ")", text);
+        }
+        text += "\n";
+    }
+
+private:
+    const CorpusOptions& options;
+    Random random;
+
+    void line(int indent, const std::string& statement, std::string& text) {
+        if (random.chance(options.comments))
+            text += std::string(indent * 4, ' ') + "# note " + std::to_string(random.below(1000)) + "\n";
+        text += std::string(indent * 4, ' ') + statement + "\n";
+    }
+
+    void block(int indent, int depth, const std::string& result, std::string& text) {
+        std::string pad(indent * 4, ' ');
+        for (size_t count = 1 + random.below(3); count > 0; --count) {
+            std::string k = std::to_string(1 + random.below(9));
+            if (depth > 0 && random.chance(0.5)) {
+                if (random.chance(0.5)) {
+                    line(indent, "if (v > " + k + ") {", text);
+                    block(indent + 1, depth - 1, result, text);
+                    if (random.chance(0.3)) {
+                        text += pad + "} else {\n";
+                        block(indent + 1, depth - 1, result, text);
+                    }
+                } else {
+                    line(indent, "for (i" + std::to_string(depth) + " in seq_len(" + k + ")) {", text);
+                    block(indent + 1, depth - 1, result, text);
+                }
+                text += pad + "}\n";
+                continue;
+            }
+            switch (random.below(4)) {
+            case 0: line(indent, "v <- v + " + k + " * 2", text); break;
+            case 1: line(indent, "v <- max(v, " + k + ")", text); break;
+            case 2: line(indent, "label <- paste0(\"v\", v, \"_" + k + "\")", text); break;
+            default: line(indent, "if (v > " + k + "00) return(" + result + ")", text); break;
+            }
+        }
+    }
+};
+
+} // namespace
+
+uint64_t writeCorpus(std::ostream& out, const CorpusOptions& options) {
+    Writer writer(options);
+    std::string text = "# Synthetic corpus, seed " + std::to_string(options.seed) + "\n\n";
+    uint64_t written = 0;
+    for (uint64_t n = 0; options.functions == 0 || n < options.functions; ++n) {
+        writer.function(n, text);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        written += text.size();
+        text.clear();
+        if (!out || (options.functions == 0 && written >= options.size))
+            break;
+    }
+    return written;
+}
+
+bool parseByteSize(const std::string& text, uint64_t& bytes) {
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str())
+        return false;
+    std::string unit(end);
+    uint64_t scale = 1;
+    if (unit.size() == 1) {
+        switch (std::toupper(static_cast<unsigned char>(unit[0]))) {
+        case 'K': scale = 1ULL << 10; break;
+        case 'M': scale = 1ULL << 20; break;
+        case 'G': scale = 1ULL << 30; break;
+        default: return false;
+        }
+    } else if (!unit.empty()) {
+        return false;
+    }
+    bytes = value * scale;
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Deterministic synthetic R programs for performance testing. The same
+// options always give the same bytes, on every platform: the generator
+// draws from its own PRNG rather than <random>'s distributions.
+//
+// A corpus is a sequence of contracted functions, each followed by calls
+// to it with arguments that satisfy its contract, so that the output both
+// compiles and runs.
+struct CorpusOptions {
+    uint64_t seed = 1;
+    uint64_t size = 1 << 20;  // stop after the function that reaches this many bytes,
+    uint64_t functions = 0;   // unless this many functions are asked for instead
+    int arguments = 3;        // arguments per contract
+    int complexity = 1;       // 0: scalars; 1: T[], T?, dataframe; 2: unions, list<T>; 3: class<...>
+    int depth = 2;            // nesting depth of if/for blocks in function bodies
+    double comments = 0.1;    // chance of a comment line before each statement
+    int calls = 2;            // call sites per function
+};
+
+// Writes a corpus to out. Returns the number of bytes written.
+uint64_t writeCorpus(std::ostream& out, const CorpusOptions& options);
+
+// Parses a size such as 4096, 64K, 10M or 1G (powers of 1024).
+bool parseByteSize(const std::string& text, uint64_t& bytes);
+
+#endif
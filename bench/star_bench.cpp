@@ -0,0 +1,218 @@
+// Microbenchmarks of star's compiler phases over synthetic sources (see
+// corpus.h) of 1 KB, 32 KB, 1 MB ... up to --max-size, for comparing one
+// build of star against another.
+// Prints one JSON document on stdout:
+//
+//   {"star_version": "0.1.0", "repeat": 5, "results": [
+//     {"phase": "generateAST", "tokens": 10000, "ns_per_token": 41.2,
+//      "allocations": 10321, "peak_rss_kb": 80412}, ...]}
+//
+// ns_per_token is the best of --repeat runs divided by the number of code
+// tokens in the input; allocations counts C++ heap allocations in one run
+// (R's own allocations are not included); peak_rss_kb is the process
+// high-water mark once the phase has run. Needs only the local R install.
+//
+//   star_bench [--max-size=<bytes>] [--complexity=<0-3>] [--repeat=N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "corpus.h"
+#include "compiler.h"
+#include "format.h"
+#include "gensource.h"
+#include "nativeparse.h"
+#include "parse.h"
+#include "pipeline.h"
+#include "rsession.h"
+#include "timings.h"
+#include "typelang.h"
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct Result {
+    std::string phase;
+    size_t tokens;
+    double nsPerToken;
+    size_t allocations;
+    long peakRssKb;
+};
+
+// Runs setup() then run() repeat times and keeps the fastest run() and the
+// allocations of the last one. Only run() is timed.
+template <typename Setup, typename Run>
+Result measure(const char* phase, size_t tokens, int repeat, Setup setup, Run run) {
+    double best = -1.0;
+    size_t allocated = 0;
+    for (int r = 0; r < repeat; ++r) {
+        setup();
+        size_t before = allocations.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        allocated = allocations.load(std::memory_order_relaxed) - before;
+        if (best < 0.0 || ns < best)
+            best = ns;
+    }
+    return {phase, tokens, best / static_cast<double>(tokens), allocated, peakRssKb()};
+}
+
+template <typename Run>
+Result measure(const char* phase, size_t tokens, int repeat, Run run) {
+    return measure(phase, tokens, repeat, [] {}, run);
+}
+
+// A unit ready for the check injection passes: parsed with the native
+// front end, with its contracts loaded.
+std::unique_ptr<CompilationUnit> preparedUnit(const std::string& source) {
+    auto unit = std::make_unique<CompilationUnit>();
+    unit->name = "<bench>";
+    unit->source = source;
+    unit->roots = parseSource(source, "<bench>", Frontend::Native, unit->arena);
+    unit->tree = SyntaxTree(unit->roots, source);
+    unit->tokens = terminalTokens(unit->roots);
+    loadContracts(source);
+    return unit;
+}
+
+void benchSize(const std::string& source, const std::string& path, int repeat, std::vector<Result>& results) {
+    ParseArena probe;
+    size_t tokens = terminalTokens(nativeParseSource(source, probe)).size();
+
+    SEXP parseData = R_NilValue;
+    results.push_back(measure("tokenizeRSource", tokens, repeat, [&] { parseData = tokenizeRSource(path.c_str()); }));
+    if (parseData == R_NilValue)
+        throw std::runtime_error("R failed to parse the synthetic source");
+    R_PreserveObject(parseData);
+
+    std::unique_ptr<ParseArena> arena;
+    std::vector<ParseNode*> roots;
+    results.push_back(measure("generateAST", tokens, repeat, [&] { arena = std::make_unique<ParseArena>(); },
+                              [&] { roots = generateAST(parseData, *arena); }));
+    R_ReleaseObject(parseData);
+
+    std::vector<ParseNode*> nodes;
+    results.push_back(measure("flattenAST", tokens, repeat, [&] { nodes = flattenAST(roots); }));
+
+    std::vector<std::string> types;
+    for (const std::string& line : contractLines(source))
+        types.push_back(line.substr(line.find('(')));
+    results.push_back(measure("parseType", tokens, repeat, [&] {
+        for (const std::string& type : types)
+            TypeParser(type).parseType();
+    }));
+
+    std::vector<StatementRange> ranges;
+    results.push_back(measure("extractStatements", tokens, repeat, [&] { ranges = extractStatements(nodes); }));
+    results.push_back(
+        measure("getStatementStrings", tokens, repeat, [&] { getStatementStrings(nodes, ranges); }));
+
+    std::vector<ParseNode*> code = terminalTokens(roots);
+    results.push_back(measure("formatTokens", tokens, repeat, [&] { formatTokens(code); }));
+
+    std::unique_ptr<CompilationUnit> unit;
+    results.push_back(measure("injectInputTypeChecks", tokens, repeat, [&] { unit = preparedUnit(source); },
+                              [&] {
+                                  injectInputTypeChecks(*unit, true, false, false, false);
+                                  unit->edits.apply(unit->tokens);
+                              }));
+    results.push_back(measure("generateOutputTypeChecks", tokens, repeat, [&] { unit = preparedUnit(source); },
+                              [&] {
+                                  generateOutputTypeChecks(*unit, true, false, false);
+                                  unit->edits.apply(unit->tokens);
+                              }));
+}
+
+void printJson(const std::vector<Result>& results, int repeat) {
+    std::cout << "{\"star_version\": \"" << STAR_VERSION << "\", \"repeat\": " << repeat << ", \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::cout << (i ? ",\n  " : "\n  ") << "{\"phase\": \"" << r.phase << "\", \"tokens\": " << r.tokens
+                  << ", \"ns_per_token\": " << std::fixed << std::setprecision(2) << r.nsPerToken
+                  << ", \"allocations\": " << r.allocations << ", \"peak_rss_kb\": " << r.peakRssKb << "}";
+    }
+    std::cout << "\n]}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t maxSize = 1 << 20;
+    CorpusOptions corpus;
+    int repeat = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (startsWith(arg, "--max-size=") && parseByteSize(arg.substr(11), maxSize)) {
+            continue;
+        } else if (startsWith(arg, "--complexity=")) {
+            corpus.complexity = std::atoi(arg.c_str() + 13);
+        } else if (startsWith(arg, "--repeat=")) {
+            repeat = std::max(1, std::atoi(arg.c_str() + 9));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--max-size=<bytes>] [--complexity=<0-3>] [--repeat=N]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    RSession session;
+
+    std::vector<Result> results;
+    char path[] = "/tmp/star_bench_XXXXXX.R";
+    int fd = mkstemps(path, 2);
+    if (fd < 0) {
+        std::cerr << "Error: cannot create a temporary file" << std::endl;
+        return 1;
+    }
+    close(fd);
+
+    try {
+        for (corpus.size = 1 << 10; corpus.size <= maxSize; corpus.size *= 32) {
+            std::ostringstream generated;
+            writeCorpus(generated, corpus);
+            std::string source = generated.str();
+            FILE* file = std::fopen(path, "w");
+            if (!file || std::fputs(source.c_str(), file) < 0 || std::fclose(file) != 0)
+                throw std::runtime_error(std::string("cannot write ") + path);
+            benchSize(source, path, repeat, results);
+        }
+    } catch (const std::exception& e) {
+        std::remove(path);
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    std::remove(path);
+
+    printJson(results, repeat);
+    return 0;
+}
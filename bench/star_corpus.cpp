@@ -0,0 +1,81 @@
+// Writes a deterministic synthetic R program (see corpus.h) for
+// performance testing, to stdout or to -o <file>.
+//
+//   star_corpus --size=64M --complexity=3 -o corpus.R
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "corpus.h"
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] [-o <file>]" << std::endl;
+    std::cerr << "  --size=<bytes>        stop once this much is written; K, M and G suffixes (default: 1M)" << std::endl;
+    std::cerr << "  --functions=<n>       write exactly n contracted functions instead" << std::endl;
+    std::cerr << "  --arguments=<n>       arguments per contract (default: 3)" << std::endl;
+    std::cerr << "  --complexity=<0-3>    0 scalars, 1 adds T[], T? and dataframe, 2 unions and list<T>," << std::endl;
+    std::cerr << "                        3 class<...> (default: 1)" << std::endl;
+    std::cerr << "  --depth=<n>           nesting of if/for blocks in function bodies (default: 2)" << std::endl;
+    std::cerr << "  --comments=<p>        chance of a comment line before each statement (default: 0.1)" << std::endl;
+    std::cerr << "  --calls=<n>           call sites per function (default: 2)" << std::endl;
+    std::cerr << "  --seed=<n>            PRNG seed; equal options give equal output (default: 1)" << std::endl;
+}
+
+static bool startsWith(const std::string& str, const char* prefix) {
+    return str.rfind(prefix, 0) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    std::string outputPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find('=') + 1);
+        if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (startsWith(arg, "--size=")) {
+            if (!parseByteSize(value, options.size)) {
+                std::cerr << "Invalid size: " << value << std::endl;
+                return 1;
+            }
+        } else if (startsWith(arg, "--functions=")) {
+            options.functions = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (startsWith(arg, "--arguments=")) {
+            options.arguments = std::atoi(value.c_str());
+        } else if (startsWith(arg, "--complexity=")) {
+            options.complexity = std::atoi(value.c_str());
+        } else if (startsWith(arg, "--depth=")) {
+            options.depth = std::atoi(value.c_str());
+        } else if (startsWith(arg, "--comments=")) {
+            options.comments = std::atof(value.c_str());
+        } else if (startsWith(arg, "--calls=")) {
+            options.calls = std::atoi(value.c_str());
+        } else if (startsWith(arg, "--seed=")) {
+            options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: cannot write " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outputPath.empty() ? std::cout : file;
+
+    writeCorpus(out, options);
+    out.flush();
+    if (!out) {
+        std::cerr << "Error: write failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
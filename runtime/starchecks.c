@@ -0,0 +1,648 @@
+/*
+ * Native runtime type checks for code compiled with star --native-checks.
+ *
+ * Compiled functions call
+ *
+ *     .Call(.star_check, value, spec, message)
+ *
+ * which returns NULL if value passes the check spec describes and raises
+ * message as an error otherwise. A check gives the same answer as the
+ * R-level check star would generate for the same type; objects whose
+ * answer depends on S3 or S4 dispatch are handed to the R functions
+ * (is.numeric(), inherits(), as.list()) the R-level check would call.
+ *
+ * A spec is a type in prefix form, one space between tokens:
+ *
+ *     spec := NAME                  is.NAME(x); is.data.frame(x) for dataframe
+ *           | "[" ATOMIC spec       is.ATOMIC(x) || is.list(x) && every element passes
+ *           | "[" "-" spec          is.vector(x) && every element passes
+ *           | "list<" spec          is.list(x) && every element passes
+ *           | "class" N ID...       inherits(x, c(ID...))
+ *           | "|" N spec...         any of the N specs passes
+ *
+ * with NAME one of logical, integer, double, numeric, complex, character,
+ * raw, null, list, dataframe, function and environment. Specs are parsed
+ * once and cached by their CHARSXP, which R shares between equal strings.
+ *
+ * The library also holds the --memo-checks cache (see "Memo cache" below),
+ * which code compiled with that flag calls as
+ *
+ *     if (!.Call(.star_seen, value, type)) { check; .Call(.star_remember, value, type) }
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <R.h>
+#include <Rinternals.h>
+#include <R_ext/Rdynload.h>
+
+typedef enum {
+    CHECK_LOGICAL,
+    CHECK_INTEGER,
+    CHECK_DOUBLE,
+    CHECK_NUMERIC,
+    CHECK_COMPLEX,
+    CHECK_CHARACTER,
+    CHECK_RAW,
+    CHECK_NULL,
+    CHECK_LIST,
+    CHECK_DATAFRAME,
+    CHECK_FUNCTION,
+    CHECK_ENVIRONMENT,
+    CHECK_ATOMIC_VECTOR,
+    CHECK_VECTOR,
+    CHECK_LIST_OF,
+    CHECK_CLASS,
+    CHECK_UNION
+} CheckKind;
+
+static const char *const checkNames[] = {
+    "logical", "integer", "double", "numeric", "complex", "character",
+    "raw", "null", "list", "dataframe", "function", "environment"
+};
+
+typedef struct Check {
+    CheckKind kind;
+    CheckKind atomic;        /* CHECK_ATOMIC_VECTOR: the whole-vector test */
+    int count;               /* CHECK_UNION: number of members */
+    struct Check **members;  /* union members, or the element check */
+    SEXP classes;            /* CHECK_CLASS: preserved character vector */
+} Check;
+
+static int passes(SEXP x, const Check *check);
+
+/* ---- Parsing ---------------------------------------------------------- */
+
+typedef struct {
+    const char *text;  /* whole spec, for error messages */
+    const char *at;
+    char token[256];
+} Cursor;
+
+static const char *nextToken(Cursor *cursor) {
+    size_t n = 0;
+    while (*cursor->at == ' ')
+        ++cursor->at;
+    while (*cursor->at && *cursor->at != ' ') {
+        if (n + 1 == sizeof cursor->token)
+            Rf_error("star check spec token too long in '%s'", cursor->text);
+        cursor->token[n++] = *cursor->at++;
+    }
+    if (n == 0)
+        Rf_error("truncated star check spec '%s'", cursor->text);
+    cursor->token[n] = '\0';
+    return cursor->token;
+}
+
+static int nextCount(Cursor *cursor) {
+    int count = atoi(nextToken(cursor));
+    if (count < 1)
+        Rf_error("invalid count in star check spec '%s'", cursor->text);
+    return count;
+}
+
+static Check *newCheck(CheckKind kind, int count) {
+    Check *check = (Check *) calloc(1, sizeof(Check));
+    if (!check)
+        Rf_error("out of memory");
+    check->kind = kind;
+    check->count = count;
+    if (count > 0) {
+        check->members = (Check **) calloc((size_t) count, sizeof(Check *));
+        if (!check->members)
+            Rf_error("out of memory");
+    }
+    return check;
+}
+
+static int checkName(const char *name, CheckKind *kind) {
+    for (int k = CHECK_LOGICAL; k <= CHECK_ENVIRONMENT; ++k) {
+        if (strcmp(name, checkNames[k]) == 0) {
+            *kind = (CheckKind) k;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static Check *parseCheck(Cursor *cursor) {
+    const char *token = nextToken(cursor);
+    CheckKind kind;
+    Check *check;
+
+    if (strcmp(token, "|") == 0) {
+        int count = nextCount(cursor);
+        check = newCheck(CHECK_UNION, count);
+        for (int i = 0; i < count; ++i)
+            check->members[i] = parseCheck(cursor);
+        return check;
+    }
+    if (strcmp(token, "[") == 0) {
+        token = nextToken(cursor);
+        if (strcmp(token, "-") == 0) {
+            check = newCheck(CHECK_VECTOR, 1);
+        } else {
+            check = newCheck(CHECK_ATOMIC_VECTOR, 1);
+            if (!checkName(token, &check->atomic) || check->atomic > CHECK_RAW)
+                Rf_error("invalid atomic type '%s' in star check spec '%s'", token, cursor->text);
+        }
+        check->members[0] = parseCheck(cursor);
+        return check;
+    }
+    if (strcmp(token, "list<") == 0) {
+        check = newCheck(CHECK_LIST_OF, 1);
+        check->members[0] = parseCheck(cursor);
+        return check;
+    }
+    if (strcmp(token, "class") == 0) {
+        int count = nextCount(cursor);
+        check = newCheck(CHECK_CLASS, 0);
+        check->classes = Rf_allocVector(STRSXP, count);
+        R_PreserveObject(check->classes);
+        for (int i = 0; i < count; ++i)
+            SET_STRING_ELT(check->classes, i, Rf_mkChar(nextToken(cursor)));
+        return check;
+    }
+    if (checkName(token, &kind))
+        return newCheck(kind, 0);
+    Rf_error("unknown type '%s' in star check spec '%s'", token, cursor->text);
+    return NULL;
+}
+
+/* ---- Spec cache ------------------------------------------------------- */
+
+#define CACHE_SLOTS 256
+
+typedef struct Entry {
+    SEXP key;  /* preserved, so the address is never reused */
+    Check *check;
+    struct Entry *next;
+} Entry;
+
+static Entry *cache[CACHE_SLOTS];
+
+static const Check *lookupCheck(SEXP spec) {
+    if (TYPEOF(spec) != STRSXP || XLENGTH(spec) != 1 || STRING_ELT(spec, 0) == NA_STRING)
+        Rf_error("star check spec must be a single string");
+    SEXP key = STRING_ELT(spec, 0);
+    size_t slot = ((uintptr_t) key >> 4) % CACHE_SLOTS;
+    for (Entry *entry = cache[slot]; entry; entry = entry->next) {
+        if (entry->key == key)
+            return entry->check;
+    }
+
+    Cursor cursor;
+    cursor.text = cursor.at = CHAR(key);
+    Check *check = parseCheck(&cursor);
+    while (*cursor.at == ' ')
+        ++cursor.at;
+    if (*cursor.at)
+        Rf_error("trailing input in star check spec '%s'", cursor.text);
+
+    Entry *entry = (Entry *) malloc(sizeof(Entry));
+    if (!entry)
+        Rf_error("out of memory");
+    R_PreserveObject(key);
+    entry->key = key;
+    entry->check = check;
+    entry->next = cache[slot];
+    cache[slot] = entry;
+    return check;
+}
+
+/* ---- Checks ----------------------------------------------------------- */
+
+/* x as an argument of a constructed call, quoted if evaluating it would
+   not yield x itself. */
+static SEXP argument(SEXP x) {
+    switch (TYPEOF(x)) {
+    case SYMSXP:
+    case LANGSXP:
+    case PROMSXP:
+        return Rf_lang2(Rf_install("quote"), x);
+    default:
+        return x;
+    }
+}
+
+/* Whether fun(x[, extra]) is TRUE, evaluated by R. */
+static int callR(const char *fun, SEXP x, SEXP extra) {
+    SEXP quoted = PROTECT(argument(x));
+    SEXP call = PROTECT(extra == NULL ? Rf_lang2(Rf_install(fun), quoted)
+                                      : Rf_lang3(Rf_install(fun), quoted, extra));
+    int result = Rf_asLogical(Rf_eval(call, R_BaseEnv)) == TRUE;
+    UNPROTECT(2);
+    return result;
+}
+
+static int hasClass(SEXP x, const char *name) {
+    SEXP klass = Rf_getAttrib(x, R_ClassSymbol);
+    for (R_xlen_t i = 0; i < Rf_xlength(klass); ++i) {
+        if (strcmp(CHAR(STRING_ELT(klass, i)), name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* inherits(x, classes). Without a class attribute inherits() goes by the
+   implicit class, and S4 objects by is(), so those are left to R. */
+static int inheritsAny(SEXP x, SEXP classes) {
+    if (!OBJECT(x) || IS_S4_OBJECT(x))
+        return callR("inherits", x, classes);
+    for (R_xlen_t i = 0; i < XLENGTH(classes); ++i) {
+        if (hasClass(x, CHAR(STRING_ELT(classes, i))))
+            return 1;
+    }
+    return 0;
+}
+
+static int isList(SEXP x) {
+    return TYPEOF(x) == VECSXP || TYPEOF(x) == LISTSXP;
+}
+
+/* is.vector(x): an atomic vector, list or expression whose only attribute,
+   if any, is names. */
+static int isPlainVector(SEXP x) {
+    switch (TYPEOF(x)) {
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case STRSXP: case RAWSXP:
+    case VECSXP: case EXPRSXP:
+        break;
+    default:
+        return 0;
+    }
+    for (SEXP attribute = ATTRIB(x); attribute != R_NilValue; attribute = CDR(attribute)) {
+        if (TAG(attribute) != R_NamesSymbol)
+            return 0;
+    }
+    return 1;
+}
+
+/* all(vapply(x, element, logical(1))). vapply() goes through as.list() for
+   objects; the elements of any other atomic vector are attribute-free
+   scalars of its type, so one stands for all of them. */
+static int allElements(SEXP x, const Check *element) {
+    int result = 1;
+    if (OBJECT(x)) {
+        SEXP quoted = PROTECT(argument(x));
+        SEXP call = PROTECT(Rf_lang2(Rf_install("as.list"), quoted));
+        SEXP list = PROTECT(Rf_eval(call, R_BaseEnv));
+        result = allElements(list, element);
+        UNPROTECT(3);
+        return result;
+    }
+
+    switch (TYPEOF(x)) {
+    case NILSXP:
+        return 1;
+    case VECSXP:
+    case EXPRSXP:
+        for (R_xlen_t i = 0; i < XLENGTH(x) && result; ++i)
+            result = passes(VECTOR_ELT(x, i), element);
+        return result;
+    case LISTSXP:
+        for (SEXP cell = x; cell != R_NilValue && result; cell = CDR(cell))
+            result = passes(CAR(cell), element);
+        return result;
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case STRSXP: case RAWSXP: {
+        if (XLENGTH(x) == 0)
+            return 1;
+        SEXP sample = PROTECT(Rf_allocVector(TYPEOF(x), 1));
+        switch (TYPEOF(x)) {
+        case LGLSXP: LOGICAL(sample)[0] = 0; break;
+        case INTSXP: INTEGER(sample)[0] = 0; break;
+        case REALSXP: REAL(sample)[0] = 0; break;
+        case CPLXSXP: COMPLEX(sample)[0].r = COMPLEX(sample)[0].i = 0; break;
+        case RAWSXP: RAW(sample)[0] = 0; break;
+        default: break;
+        }
+        result = passes(sample, element);
+        UNPROTECT(1);
+        return result;
+    }
+    default:
+        return 0;
+    }
+}
+
+static int passes(SEXP x, const Check *check) {
+    switch (check->kind) {
+    case CHECK_LOGICAL: return TYPEOF(x) == LGLSXP;
+    case CHECK_INTEGER: return TYPEOF(x) == INTSXP;
+    case CHECK_DOUBLE: return TYPEOF(x) == REALSXP;
+    case CHECK_NUMERIC:
+        /* is.numeric() dispatches, and is FALSE for factors. */
+        if (OBJECT(x))
+            return callR("is.numeric", x, NULL);
+        return TYPEOF(x) == INTSXP || TYPEOF(x) == REALSXP;
+    case CHECK_COMPLEX: return TYPEOF(x) == CPLXSXP;
+    case CHECK_CHARACTER: return TYPEOF(x) == STRSXP;
+    case CHECK_RAW: return TYPEOF(x) == RAWSXP;
+    case CHECK_NULL: return TYPEOF(x) == NILSXP;
+    case CHECK_LIST: return isList(x);
+    case CHECK_DATAFRAME:
+        if (IS_S4_OBJECT(x))
+            return callR("is.data.frame", x, NULL);
+        return OBJECT(x) && hasClass(x, "data.frame");
+    case CHECK_FUNCTION:
+        return TYPEOF(x) == CLOSXP || TYPEOF(x) == BUILTINSXP || TYPEOF(x) == SPECIALSXP;
+    case CHECK_ENVIRONMENT: return TYPEOF(x) == ENVSXP;
+    case CHECK_ATOMIC_VECTOR: {
+        Check whole = { check->atomic, 0, 0, NULL, NULL };
+        return passes(x, &whole) || (isList(x) && allElements(x, check->members[0]));
+    }
+    case CHECK_VECTOR: return isPlainVector(x) && allElements(x, check->members[0]);
+    case CHECK_LIST_OF: return isList(x) && allElements(x, check->members[0]);
+    case CHECK_CLASS: return inheritsAny(x, check->classes);
+    case CHECK_UNION:
+        for (int i = 0; i < check->count; ++i) {
+            if (passes(x, check->members[i]))
+                return 1;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+SEXP star_check(SEXP value, SEXP spec, SEXP message) {
+    if (passes(value, lookupCheck(spec)))
+        return R_NilValue;
+    if (TYPEOF(message) == STRSXP && XLENGTH(message) == 1)
+        Rf_errorcall(R_NilValue, "%s", CHAR(STRING_ELT(message, 0)));
+    Rf_errorcall(R_NilValue, "type check failed: %s", CHAR(STRING_ELT(spec, 0)));
+    return R_NilValue;
+}
+
+/* ---- Memo cache ------------------------------------------------------- */
+
+/* Objects that passed a check, remembered per type by address. A hit takes
+   constant time, whatever the size of the object:
+
+   - A remembered object is marked not mutable, so R copies it before any
+     change and the object at that address stays as it was checked. (A
+     program that goes on to modify it pays for one copy, as when the
+     object is bound to a second name.)
+   - No reference to it is kept, so it can still be freed, and after a
+     garbage collection a new object may sit at the same address. Each
+     entry therefore also holds a stamp of everything the memoized checks
+     read: the type, length and object bits of the value and of every list
+     element below it, and the names of their attributes together with
+     their class strings. The first hit on an entry after a collection
+     compares the stamp once; later hits compare the address and the
+     object's shape (type, length, attributes, first and last element).
+
+   Objects holding environments or external pointers, which change without
+   being copied, are never remembered. star only memoizes checks that read
+   nothing but the stamp (not a user-defined is.T(), which may read the
+   values). */
+
+typedef struct {
+    SEXP object;          /* address only, never dereferenced */
+    uint64_t shape;
+    uint64_t stamp;
+    unsigned long epoch;  /* collections seen when last validated */
+} Seen;
+
+typedef struct MemoType {
+    SEXP key;         /* preserved CHARSXP of the type */
+    Seen *seen;       /* ring of memoSize entries */
+    int next;
+    double hits;
+    double misses;
+    struct MemoType *link;
+} MemoType;
+
+static MemoType *memoTypes = NULL;
+static int memoSize = 16;
+
+/* Garbage collections seen so far, counted by the finalizer of a sentinel
+   that nothing references: any collection frees it. */
+static unsigned long epoch = 1;
+static int sentinelArmed = 0;
+
+static void sentinelFreed(SEXP sentinel) {
+    (void) sentinel;
+    ++epoch;
+    sentinelArmed = 0;
+}
+
+/* Runs the finalizers of a collection that has happened but whose
+   finalizers have not run yet, then arms a new sentinel. Call it after
+   anything else that allocates, so that no collection goes unseen before
+   the cache is read. */
+static void watchCollections(void) {
+    R_RunPendingFinalizers();
+    if (sentinelArmed)
+        return;
+    SEXP sentinel = PROTECT(R_MakeExternalPtr(NULL, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(sentinel, sentinelFreed, FALSE);
+    sentinelArmed = 1;
+    UNPROTECT(1);
+    /* Arming allocates, and a collection may have run meanwhile. */
+    ++epoch;
+}
+
+/* The last miss, so that .star_remember() need not compute its stamp again. */
+static struct {
+    const MemoType *type;
+    SEXP object;
+    uint64_t stamp;
+    int references;
+} pending;
+
+static uint64_t mix(uint64_t hash, uint64_t value) {
+    return (hash ^ value) * 0x100000001b3ULL;
+}
+
+static uint64_t mixString(uint64_t hash, const char *text) {
+    for (; *text; ++text)
+        hash = mix(hash, (unsigned char) *text);
+    return mix(hash, 0);
+}
+
+/* Counts the environments and external pointers below x in *references. */
+static uint64_t stamp(SEXP x, uint64_t hash, int *references) {
+    hash = mix(hash, (uint64_t) TYPEOF(x));
+    hash = mix(hash, (uint64_t) (OBJECT(x) | (IS_S4_OBJECT(x) ? 2 : 0)));
+    /* Symbols are never freed, so attribute names compare by address. */
+    for (SEXP attribute = ATTRIB(x); attribute != R_NilValue; attribute = CDR(attribute)) {
+        hash = mix(hash, (uint64_t) (uintptr_t) TAG(attribute));
+        SEXP value = CAR(attribute);
+        if (TAG(attribute) == R_ClassSymbol && TYPEOF(value) == STRSXP) {
+            for (R_xlen_t i = 0; i < XLENGTH(value); ++i)
+                hash = mixString(hash, CHAR(STRING_ELT(value, i)));
+        } else {
+            hash = mix(hash, (uint64_t) Rf_xlength(value));
+        }
+    }
+
+    switch (TYPEOF(x)) {
+    case VECSXP:
+    case EXPRSXP:
+        hash = mix(hash, (uint64_t) XLENGTH(x));
+        for (R_xlen_t i = 0; i < XLENGTH(x); ++i)
+            hash = stamp(VECTOR_ELT(x, i), hash, references);
+        return hash;
+    case LISTSXP:
+        for (SEXP cell = x; cell != R_NilValue; cell = CDR(cell))
+            hash = stamp(CAR(cell), hash, references);
+        return mix(hash, 0);
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case STRSXP: case RAWSXP:
+        return mix(hash, (uint64_t) XLENGTH(x));
+    case ENVSXP: case EXTPTRSXP: case WEAKREFSXP:
+        ++*references;
+        return hash;
+    default:
+        return hash;
+    }
+}
+
+static uint64_t stampOf(SEXP x, int *references) {
+    *references = 0;
+    return stamp(x, 0xcbf29ce484222325ULL, references);
+}
+
+static uint64_t shape(SEXP x) {
+    uint64_t hash = mix(0xcbf29ce484222325ULL, (uint64_t) TYPEOF(x));
+    hash = mix(hash, (uint64_t) (uintptr_t) ATTRIB(x));
+    if (TYPEOF(x) == VECSXP || TYPEOF(x) == EXPRSXP) {
+        R_xlen_t n = XLENGTH(x);
+        hash = mix(hash, (uint64_t) n);
+        if (n > 0) {
+            hash = mix(hash, (uint64_t) (uintptr_t) VECTOR_ELT(x, 0));
+            hash = mix(hash, (uint64_t) (uintptr_t) VECTOR_ELT(x, n - 1));
+        }
+    }
+    return hash;
+}
+
+static MemoType *memoType(SEXP type) {
+    if (TYPEOF(type) != STRSXP || XLENGTH(type) != 1 || STRING_ELT(type, 0) == NA_STRING)
+        Rf_error("star memo type must be a single string");
+    SEXP key = STRING_ELT(type, 0);
+    for (MemoType *entry = memoTypes; entry; entry = entry->link) {
+        if (entry->key == key)
+            return entry;
+    }
+
+    MemoType *entry = (MemoType *) calloc(1, sizeof(MemoType));
+    Seen *seen = (Seen *) calloc((size_t) memoSize, sizeof(Seen));
+    if (!entry || !seen) {
+        free(entry);
+        free(seen);
+        Rf_error("out of memory");
+    }
+    R_PreserveObject(key);
+    entry->key = key;
+    entry->seen = seen;
+    entry->link = memoTypes;
+    memoTypes = entry;
+    return entry;
+}
+
+/* TRUE if value passed the check of type before and is unchanged. */
+SEXP star_memo_seen(SEXP value, SEXP type) {
+    MemoType *entry = memoType(type);
+    watchCollections();
+    for (int i = 0; i < memoSize; ++i) {
+        Seen *seen = &entry->seen[i];
+        if (seen->object != value)
+            continue;
+        if (seen->shape != shape(value))
+            break;
+        if (seen->epoch != epoch) {
+            int references;
+            if (stampOf(value, &references) != seen->stamp)
+                break;
+            seen->epoch = epoch;
+        }
+        entry->hits += 1;
+        return Rf_ScalarLogical(TRUE);
+    }
+    entry->misses += 1;
+    pending.type = entry;
+    pending.object = value;
+    pending.stamp = stampOf(value, &pending.references);
+    return Rf_ScalarLogical(FALSE);
+}
+
+/* Records that value passed the check of type, evicting the oldest entry. */
+SEXP star_memo_remember(SEXP value, SEXP type) {
+    MemoType *entry = memoType(type);
+    int references;
+    uint64_t current;
+    if (pending.type == entry && pending.object == value) {
+        current = pending.stamp;
+        references = pending.references;
+    } else {
+        current = stampOf(value, &references);
+    }
+    pending.type = NULL;
+    if (references > 0)
+        return R_NilValue;
+
+    MARK_NOT_MUTABLE(value);
+    Seen *slot = &entry->seen[entry->next];
+    slot->object = value;
+    slot->shape = shape(value);
+    slot->stamp = current;
+    slot->epoch = epoch;
+    entry->next = (entry->next + 1) % memoSize;
+    return R_NilValue;
+}
+
+/* Empties the cache and its counts, keeping size entries per type. */
+SEXP star_memo_reset(SEXP size) {
+    int n = Rf_asInteger(size);
+    if (n == NA_INTEGER || n < 1)
+        Rf_error("star cache size must be a positive integer");
+    while (memoTypes) {
+        MemoType *entry = memoTypes;
+        memoTypes = entry->link;
+        R_ReleaseObject(entry->key);
+        free(entry->seen);
+        free(entry);
+    }
+    memoSize = n;
+    pending.type = NULL;
+    return R_NilValue;
+}
+
+/* list(type, hits, misses), one element per type seen so far. */
+SEXP star_memo_stats(void) {
+    R_xlen_t count = 0;
+    for (MemoType *entry = memoTypes; entry; entry = entry->link)
+        ++count;
+
+    SEXP stats = PROTECT(Rf_allocVector(VECSXP, 3));
+    SEXP types = Rf_allocVector(STRSXP, count);
+    SET_VECTOR_ELT(stats, 0, types);
+    SEXP hits = Rf_allocVector(REALSXP, count);
+    SET_VECTOR_ELT(stats, 1, hits);
+    SEXP misses = Rf_allocVector(REALSXP, count);
+    SET_VECTOR_ELT(stats, 2, misses);
+
+    R_xlen_t i = 0;
+    for (MemoType *entry = memoTypes; entry; entry = entry->link, ++i) {
+        SET_STRING_ELT(types, i, entry->key);
+        REAL(hits)[i] = entry->hits;
+        REAL(misses)[i] = entry->misses;
+    }
+    UNPROTECT(1);
+    return stats;
+}
+
+static const R_CallMethodDef callMethods[] = {
+    {"star_check", (DL_FUNC) &star_check, 3},
+    {"star_memo_seen", (DL_FUNC) &star_memo_seen, 2},
+    {"star_memo_remember", (DL_FUNC) &star_memo_remember, 2},
+    {"star_memo_reset", (DL_FUNC) &star_memo_reset, 1},
+    {"star_memo_stats", (DL_FUNC) &star_memo_stats, 0},
+    {NULL, NULL, 0}
+};
+
+void R_init_starchecks(DllInfo *info) {
+    R_registerRoutines(info, NULL, callMethods, NULL, NULL);
+    R_useDynamicSymbols(info, FALSE);
+}
@@ -0,0 +1,52 @@
+#include <cstring>
+#include <new>
+
+#include "arena.h"
+
+// First block size; later blocks grow geometrically.
+static const size_t INITIAL_BLOCK = 64 * 1024;
+
+void* CountingResource::do_allocate(size_t size, size_t alignment) {
+    ++allocations;
+    bytes += size;
+    return ::operator new(size, std::align_val_t(alignment));
+}
+
+void CountingResource::do_deallocate(void* p, size_t size, size_t alignment) {
+    ::operator delete(p, size, std::align_val_t(alignment));
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+ParseArena::ParseArena() : pool(INITIAL_BLOCK, &upstream), strings(&pool) {}
+
+ParseNode* ParseArena::makeNode(int id, int parent, std::string_view token, std::string_view text) {
+    void* memory = pool.allocate(sizeof(ParseNode), alignof(ParseNode));
+    auto* node = new (memory) ParseNode(&pool);
+    node->id = id;
+    node->parent = parent;
+    node->token = intern(token);
+    node->kind = tokenKind(node->token);
+    node->text = intern(text);
+    ++nodes;
+    return node;
+}
+
+std::string_view ParseArena::intern(std::string_view str) {
+    if (str.empty())
+        return {};
+
+    auto it = strings.find(str);
+    if (it != strings.end())
+        return *it;
+
+    char* copy = static_cast<char*>(pool.allocate(str.size(), 1));
+    std::memcpy(copy, str.data(), str.size());
+    return *strings.insert(std::string_view(copy, str.size())).first;
+}
+
+ArenaStats ParseArena::stats() const {
+    return {nodes, strings.size(), upstream.bytes, upstream.allocations};
+}
@@ -0,0 +1,55 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_set>
+
+#include "parse.h"
+
+// Upstream resource that counts what the arena asks the heap for.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t bytes = 0;
+
+private:
+    void* do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void* p, size_t size, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+struct ArenaStats {
+    size_t nodes;
+    size_t strings;         // distinct interned strings
+    size_t bytes;           // requested from the heap
+    size_t allocations;     // heap allocations made by the arena
+};
+
+// Owns every ParseNode of one compilation unit, their child and argument
+// vectors and the interned token and text strings. Nodes are bump
+// allocated and never destroyed individually; everything is released at
+// once when the arena goes away, so no ParseNode or string_view taken from
+// it may outlive it.
+class ParseArena {
+public:
+    ParseArena();
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator=(const ParseArena&) = delete;
+
+    ParseNode* makeNode(int id, int parent, std::string_view token, std::string_view text = {});
+
+    // Returns the arena's copy of str, shared by every equal string.
+    std::string_view intern(std::string_view str);
+
+    ArenaStats stats() const;
+
+private:
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource pool;
+    std::pmr::unordered_set<std::string_view> strings;
+    size_t nodes = 0;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include <unordered_map>
+
+#include "ast.h"
+#include "parse.h"
+
+TokenKind tokenKind(std::string_view name) {
+    static const std::unordered_map<std::string_view, TokenKind> table = {
+#define STAR_TOKEN_ENTRY(name, text) {text, TokenKind::name},
+        STAR_TOKEN_KINDS(STAR_TOKEN_ENTRY)
+#undef STAR_TOKEN_ENTRY
+    };
+    auto it = table.find(name);
+    return it == table.end() ? TokenKind::Unknown : it->second;
+}
+
+std::string_view tokenName(TokenKind kind) {
+    static const std::string_view names[] = {
+#define STAR_TOKEN_NAME(name, text) text,
+        STAR_TOKEN_KINDS(STAR_TOKEN_NAME)
+#undef STAR_TOKEN_NAME
+        "",
+    };
+    return names[static_cast<size_t>(kind)];
+}
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+SyntaxTree::SyntaxTree(const std::vector<ParseNode*>& roots, const std::string& source) : sourceSize(source.size()), buffer(source) {
+    std::vector<ParseNode*> nodes = flattenAST(roots);
+    size_t count = nodes.size();
+
+    ids.resize(count);
+    parents.assign(count, -1);
+    kinds.resize(count);
+    textOffsets.assign(count, 0);
+    textLengths.assign(count, 0);
+    firstChildren.assign(count, -1);
+    nextSiblings.assign(count, -1);
+
+    int maxId = 0;
+    for (const ParseNode* node : nodes)
+        maxId = std::max(maxId, node->id);
+    rowsById.assign(maxId + 1, -1);
+
+    size_t cursor = 0;
+    for (size_t row = 0; row < count; ++row) {
+        const ParseNode* node = nodes[row];
+        ids[row] = node->id;
+        kinds[row] = node->kind;
+        rowsById[node->id] = static_cast<int>(row);
+        if (node->text.empty())
+            continue;
+
+        // Terminals come in source order, separated only by blanks.
+        size_t at = cursor;
+        while (at < source.size() && isBlank(source[at]))
+            ++at;
+        if (source.compare(at, node->text.size(), node->text) == 0) {
+            textOffsets[row] = static_cast<uint32_t>(at);
+            cursor = at + node->text.size();
+        } else {
+            textOffsets[row] = static_cast<uint32_t>(buffer.size());
+            buffer.append(node->text);
+        }
+        textLengths[row] = static_cast<uint32_t>(node->text.size());
+    }
+
+    // Link children back to front so that each list ends up in row order.
+    for (size_t i = count; i-- > 0;) {
+        int row = static_cast<int>(i);
+        int parentRow = nodes[i]->parent > 0 ? this->row(nodes[i]->parent) : -1;
+        parents[row] = parentRow;
+        if (parentRow >= 0) {
+            nextSiblings[row] = firstChildren[parentRow];
+            firstChildren[parentRow] = row;
+        } else {
+            nextSiblings[row] = firstRoot;
+            firstRoot = row;
+        }
+    }
+}
+
+int SyntaxTree::line(int row) const {
+    // Terminals are in source order, so the first token is the lowest
+    // terminal row below row.
+    int first = -1;
+    std::vector<int> pending{row};
+    while (!pending.empty()) {
+        int current = pending.back();
+        pending.pop_back();
+        if (isTerminal(current)) {
+            if (textLengths[current] > 0 && (first < 0 || current < first))
+                first = current;
+            continue;
+        }
+        for (int child : children(current))
+            pending.push_back(child);
+    }
+    if (first < 0 || textOffsets[first] >= sourceSize)
+        return 0;
+    return 1 + static_cast<int>(std::count(buffer.begin(), buffer.begin() + textOffsets[first], '\n'));
+}
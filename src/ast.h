@@ -0,0 +1,227 @@
+#ifndef AST_H
+#define AST_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct ParseNode;
+
+// The token and non-terminal names of R's parse data. X(Enumerator, "name").
+#define STAR_TOKEN_KINDS(X) \
+    X(Expr, "expr") \
+    X(EqualAssign, "equal_assign") \
+    X(ExprOrAssignOrHelp, "expr_or_assign_or_help") \
+    X(Forcond, "forcond") \
+    X(Exprlist, "exprlist") \
+    X(Sublist, "sublist") \
+    X(Formlist, "formlist") \
+    X(EndOfInput, "END_OF_INPUT") \
+    X(Error, "ERROR") \
+    X(StrConst, "STR_CONST") \
+    X(NumConst, "NUM_CONST") \
+    X(NullConst, "NULL_CONST") \
+    X(Symbol, "SYMBOL") \
+    X(Function, "FUNCTION") \
+    X(IncompleteString, "INCOMPLETE_STRING") \
+    X(LeftAssign, "LEFT_ASSIGN") \
+    X(EqAssign, "EQ_ASSIGN") \
+    X(RightAssign, "RIGHT_ASSIGN") \
+    X(Lbb, "LBB") \
+    X(For, "FOR") \
+    X(In, "IN") \
+    X(If, "IF") \
+    X(Else, "ELSE") \
+    X(While, "WHILE") \
+    X(Next, "NEXT") \
+    X(Break, "BREAK") \
+    X(Repeat, "REPEAT") \
+    X(Gt, "GT") \
+    X(Ge, "GE") \
+    X(Lt, "LT") \
+    X(Le, "LE") \
+    X(Eq, "EQ") \
+    X(Ne, "NE") \
+    X(And, "AND") \
+    X(Or, "OR") \
+    X(And2, "AND2") \
+    X(Or2, "OR2") \
+    X(NsGet, "NS_GET") \
+    X(NsGetInt, "NS_GET_INT") \
+    X(Comment, "COMMENT") \
+    X(LineDirective, "LINE_DIRECTIVE") \
+    X(SymbolFormals, "SYMBOL_FORMALS") \
+    X(EqFormals, "EQ_FORMALS") \
+    X(EqSub, "EQ_SUB") \
+    X(SymbolSub, "SYMBOL_SUB") \
+    X(SymbolFunctionCall, "SYMBOL_FUNCTION_CALL") \
+    X(SymbolPackage, "SYMBOL_PACKAGE") \
+    X(Slot, "SLOT") \
+    X(Special, "SPECIAL") \
+    X(Pipe, "PIPE") \
+    X(Placeholder, "PLACEHOLDER") \
+    X(Pipebind, "PIPEBIND") \
+    X(Plus, "'+'") \
+    X(Minus, "'-'") \
+    X(Star, "'*'") \
+    X(Slash, "'/'") \
+    X(Caret, "'^'") \
+    X(Tilde, "'~'") \
+    X(Question, "'?'") \
+    X(Colon, "':'") \
+    X(Equals, "'='") \
+    X(Bang, "'!'") \
+    X(Dollar, "'$'") \
+    X(At, "'@'") \
+    X(LeftParen, "'('") \
+    X(RightParen, "')'") \
+    X(LeftBracket, "'['") \
+    X(RightBracket, "']'") \
+    X(LeftBrace, "'{'") \
+    X(RightBrace, "'}'") \
+    X(Comma, "','") \
+    X(Semicolon, "';'") \
+    X(Backslash, "'\\\\'")
+
+enum class TokenKind : uint8_t {
+#define STAR_TOKEN_ENUM(name, text) name,
+    STAR_TOKEN_KINDS(STAR_TOKEN_ENUM)
+#undef STAR_TOKEN_ENUM
+    Unknown,
+};
+
+// Maps a parse-data token name to its kind; Unknown for anything else.
+TokenKind tokenKind(std::string_view name);
+
+// The parse-data name of kind ("" for Unknown).
+std::string_view tokenName(TokenKind kind);
+
+// Columnar copy of a parse tree: one row per node, in id order (source
+// order for terminals), with parallel id, parent, kind and text columns.
+// Text is an offset/length into a buffer that starts with the unit's source,
+// so token text points straight into it; only text that does not appear
+// there verbatim is appended. Links are row indices, -1 when absent.
+// The ParseNode trees it is built from stay valid as a compatibility view.
+class SyntaxTree {
+public:
+    SyntaxTree() = default;
+
+    // Builds the columns from the trees a front end produced.
+    SyntaxTree(const std::vector<ParseNode*>& roots, const std::string& source);
+
+    size_t size() const { return kinds.size(); }
+
+    int id(int row) const { return ids[row]; }
+    int parent(int row) const { return parents[row]; }
+    TokenKind kind(int row) const { return kinds[row]; }
+    std::string_view text(int row) const {
+        return std::string_view(buffer).substr(textOffsets[row], textLengths[row]);
+    }
+    bool isTerminal(int row) const { return firstChildren[row] < 0; }
+
+    // 1-based source line of the first token of row, or 0 if its text is
+    // not in the source (for diagnostics; counts lines on every call).
+    int line(int row) const;
+
+    // Row of the node with the given parse-data id, or -1.
+    int row(int id) const {
+        return id >= 0 && static_cast<size_t>(id) < rowsById.size() ? rowsById[id] : -1;
+    }
+
+    // Kind of the first child of row, Unknown for terminals. Distinguishes
+    // expressions by shape: a block starts with '{', a function with FUNCTION.
+    TokenKind leadingKind(int row) const {
+        int child = firstChildren[row];
+        return child < 0 ? TokenKind::Unknown : kinds[child];
+    }
+
+    class ChildIterator {
+    public:
+        ChildIterator(const SyntaxTree* tree, int row) : tree(tree), current(row) {}
+        int operator*() const { return current; }
+        ChildIterator& operator++() {
+            current = tree->nextSiblings[current];
+            return *this;
+        }
+        bool operator!=(const ChildIterator& other) const { return current != other.current; }
+
+    private:
+        const SyntaxTree* tree;
+        int current;
+    };
+
+    struct ChildRange {
+        const SyntaxTree* tree;
+        int first;
+        ChildIterator begin() const { return ChildIterator(tree, first); }
+        ChildIterator end() const { return ChildIterator(tree, -1); }
+    };
+
+    // Children of row in source order; roots() for the top level.
+    ChildRange children(int row) const { return {this, firstChildren[row]}; }
+    ChildRange roots() const { return {this, firstRoot}; }
+
+    // Calls f(row) for every row, in source order.
+    template <typename F>
+    void forEachRow(F&& f) const {
+        for (size_t row = 0; row < size(); ++row)
+            f(static_cast<int>(row));
+    }
+
+    // Calls f(row) for every non-comment terminal with text, in source order.
+    template <typename F>
+    void forEachToken(F&& f) const {
+        for (size_t row = 0; row < size(); ++row) {
+            if (isTerminal(row) && textLengths[row] > 0 && kinds[row] != TokenKind::Comment)
+                f(static_cast<int>(row));
+        }
+    }
+
+    // Depth-first walk: visitor.enter(row, depth) before a node's children
+    // and visitor.leave(row, depth) after them. When enter() returns false
+    // the children are skipped. Iterative, so deep trees cannot overflow.
+    template <typename Visitor>
+    void walk(Visitor& visitor) const {
+        std::vector<std::pair<int, bool>> stack;
+        std::vector<int> depths;
+        for (int root : roots()) {
+            stack.push_back({root, false});
+            while (!stack.empty()) {
+                auto [row, leaving] = stack.back();
+                stack.pop_back();
+                if (leaving) {
+                    depths.pop_back();
+                    visitor.leave(row, static_cast<int>(depths.size()));
+                    continue;
+                }
+                int depth = static_cast<int>(depths.size());
+                if (!visitor.enter(row, depth))
+                    continue;
+                depths.push_back(row);
+                stack.push_back({row, true});
+                size_t mark = stack.size();
+                for (int child : children(row))
+                    stack.push_back({child, false});
+                std::reverse(stack.begin() + mark, stack.end());
+            }
+        }
+    }
+
+private:
+    std::vector<int> ids;
+    std::vector<int> parents;
+    std::vector<TokenKind> kinds;
+    std::vector<uint32_t> textOffsets;
+    std::vector<uint32_t> textLengths;
+    std::vector<int> firstChildren;
+    std::vector<int> nextSiblings;
+    std::vector<int> rowsById;
+    int firstRoot = -1;
+    size_t sourceSize = 0;
+    std::string buffer;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "build.h"
+#include "compiler.h"
+#include "parallel.h"
+
+namespace fs = std::filesystem;
+
+static bool isRSource(const fs::path& path) {
+    std::string ext = path.extension().string();
+    return ext == ".R" || ext == ".r";
+}
+
+std::vector<BuildUnit> collectBuildUnits(const std::string& input, const std::string& outputDir) {
+    std::vector<BuildUnit> units;
+    fs::path root(input);
+    fs::path outRoot(outputDir);
+
+    if (fs::is_directory(root)) {
+        for (const auto& entry : fs::recursive_directory_iterator(root)) {
+            if (!entry.is_regular_file() || !isRSource(entry.path()))
+                continue;
+            fs::path rel = fs::relative(entry.path(), root);
+            units.push_back({entry.path().string(), (outRoot / rel).string()});
+        }
+    } else if (fs::is_regular_file(root)) {
+        std::ifstream manifest(input);
+        fs::path base = root.parent_path();
+        std::string line;
+        while (std::getline(manifest, line)) {
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            fs::path source(line);
+            fs::path rel = source.is_absolute() ? source.filename() : source;
+            fs::path resolved = source.is_absolute() ? source : base / source;
+            units.push_back({resolved.string(), (outRoot / rel).string()});
+        }
+    } else {
+        throw std::runtime_error("Build input is neither a directory nor a manifest: " + input);
+    }
+
+    std::sort(units.begin(), units.end(), [](const BuildUnit& a, const BuildUnit& b) {
+        return a.input < b.input;
+    });
+    return units;
+}
+
+// Compiles one unit, echoing to echo; bytes is set to the size of its input.
+static bool buildUnit(const BuildUnit& unit, const CompileOptions& options, uintmax_t& bytes, std::ostream& echo) {
+    std::error_code ec;
+    bytes = fs::file_size(unit.input, ec);
+    if (ec) {
+        bytes = 0;
+        std::cerr << "File not found: " << unit.input << std::endl;
+        return false;
+    }
+
+    fs::path outParent = fs::path(unit.output).parent_path();
+    if (!outParent.empty())
+        fs::create_directories(outParent, ec);
+
+    try {
+        return compileFile(unit.input.c_str(), unit.output.c_str(), options, echo);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << unit.input << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+BuildReport buildProject(const std::vector<BuildUnit>& units, const CompileOptions& options) {
+    BuildReport report;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uintmax_t> bytes(units.size(), 0);
+    std::vector<char> built(units.size(), 0);
+    if (options.pool) {
+        // Files are the unit of parallelism; each compiles on one worker.
+        // Their echoes are buffered and printed in unit order, each once
+        // every unit before it has been printed, so stdout does not depend
+        // on which worker finishes first.
+        CompileOptions fileOptions = options;
+        fileOptions.pool = nullptr;
+        std::vector<std::string> echoes(units.size());
+        std::vector<char> finished(units.size(), 0);
+        size_t printed = 0;
+        std::mutex mutex;
+        options.pool->forEach(units.size(), [&](size_t i) {
+            std::ostringstream echo;
+            built[i] = buildUnit(units[i], fileOptions, bytes[i], echo);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            echoes[i] = echo.str();
+            finished[i] = 1;
+            for (; printed < units.size() && finished[printed]; ++printed) {
+                std::cout << echoes[printed];
+                std::string().swap(echoes[printed]);
+            }
+            std::cout.flush();
+        });
+    } else {
+        for (size_t i = 0; i < units.size(); ++i)
+            built[i] = buildUnit(units[i], options, bytes[i], std::cout);
+    }
+
+    for (size_t i = 0; i < units.size(); ++i) {
+        ++report.files;
+        report.bytes += bytes[i];
+        if (!built[i])
+            ++report.failed;
+    }
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+void printBuildReport(const BuildReport& report) {
+    double seconds = report.seconds > 0.0 ? report.seconds : 1e-9;
+    double megabytes = report.bytes / (1024.0 * 1024.0);
+
+    std::cerr << std::fixed << std::setprecision(2)
+              << "Built " << (report.files - report.failed) << "/" << report.files << " files ("
+              << megabytes << " MB) in " << report.seconds << " s: "
+              << report.files / seconds << " files/s, "
+              << megabytes / seconds << " MB/s" << std::endl;
+}
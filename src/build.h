@@ -0,0 +1,32 @@
+#ifndef BUILD_H
+#define BUILD_H
+
+#include <string>
+#include <vector>
+
+#include "compiler.h"
+
+struct BuildUnit {
+    std::string input;
+    std::string output;
+};
+
+struct BuildReport {
+    size_t files = 0;
+    size_t failed = 0;
+    size_t bytes = 0;
+    double seconds = 0.0;
+};
+
+// Expands a directory (every *.R / *.r file below it) or a manifest
+// (one path per line, relative to the manifest, '#' starts a comment)
+// into input/output pairs rooted at outputDir.
+std::vector<BuildUnit> collectBuildUnits(const std::string& input, const std::string& outputDir);
+
+// Compiles every unit in the current process, on options.pool's workers
+// when it is set. The caller owns the RSession.
+BuildReport buildProject(const std::vector<BuildUnit>& units, const CompileOptions& options);
+
+void printBuildReport(const BuildReport& report);
+
+#endif
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+#include "cache.h"
+#include "compiler.h"
+#include "hash.h"
+#include "pipeline.h"
+
+namespace fs = std::filesystem;
+
+std::string CompileCache::defaultDirectory() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/star";
+    if (const char* home = std::getenv("HOME"); home && *home)
+        return std::string(home) + "/.cache/star";
+    return ".star-cache";
+}
+
+CompileCache::CompileCache(const std::string& directory, uint64_t maxBytes)
+    : directory(directory), maxBytes(maxBytes), currentBytes(0) {
+    fs::create_directories(fs::path(directory) / "objects");
+
+    std::error_code ec;
+    for (const auto& entry : fs::recursive_directory_iterator(fs::path(directory) / "objects", ec)) {
+        if (entry.is_regular_file(ec))
+            currentBytes += entry.file_size(ec);
+    }
+}
+
+CompileCache::~CompileCache() {
+    try {
+        saveStats();
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: could not save cache statistics: " << e.what() << std::endl;
+    }
+}
+
+std::string CompileCache::key(const std::string& source, const CompileOptions& options) const {
+    Hasher hasher;
+    hasher.update(std::string(STAR_VERSION));
+    hasher.update(optionsFingerprint(options));
+    for (const std::string& contract : contractLines(source))
+        hasher.update(contract);
+    hasher.update(source);
+    return hasher.digest().hex();
+}
+
+std::string CompileCache::entryPath(const std::string& key) const {
+    return (fs::path(directory) / "objects" / key.substr(0, 2) / key.substr(2)).string();
+}
+
+bool CompileCache::lookup(const std::string& key, std::string& contents) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string entry = entryPath(key);
+    std::ifstream in(entry, std::ios::binary);
+    if (!in.is_open()) {
+        ++session.misses;
+        return false;
+    }
+
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+
+    // The modification time doubles as the LRU stamp.
+    std::error_code ec;
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+    ++session.hits;
+    session.bytesSaved += contents.size();
+    return true;
+}
+
+void CompileCache::insert(const std::string& key, const std::string& contents) {
+    std::lock_guard<std::mutex> lock(mutex);
+    fs::path entry = entryPath(key);
+    std::error_code ec;
+    fs::create_directories(entry.parent_path(), ec);
+
+    // Write then rename so concurrent readers never see a partial entry.
+    fs::path staging = entry;
+    staging += ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(staging, std::ios::binary);
+        out << contents;
+        if (!out) {
+            std::cerr << "Warning: could not write cache entry " << staging.string() << std::endl;
+            return;
+        }
+    }
+    commit(key, staging.string());
+}
+
+void CompileCache::commit(const std::string& key, const std::string& staging) {
+    fs::path entry = entryPath(key);
+    std::error_code ec;
+    fs::rename(staging, entry, ec);
+    if (ec) {
+        fs::remove(staging, ec);
+        return;
+    }
+
+    currentBytes += fs::file_size(entry, ec);
+    if (currentBytes > maxBytes)
+        evict();
+}
+
+void CompileCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type used;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    std::error_code ec;
+    currentBytes = 0;
+    for (const auto& item : fs::recursive_directory_iterator(fs::path(directory) / "objects", ec)) {
+        if (!item.is_regular_file(ec))
+            continue;
+        Entry entry{item.path(), item.last_write_time(ec), item.file_size(ec)};
+        currentBytes += entry.size;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.used < b.used;
+    });
+
+    // Trim to 90% so that every store does not trigger another scan.
+    uint64_t target = maxBytes - maxBytes / 10;
+    for (const auto& entry : entries) {
+        if (currentBytes <= target)
+            break;
+        if (fs::remove(entry.path, ec)) {
+            currentBytes -= entry.size;
+            ++session.evictions;
+        }
+    }
+}
+
+CacheStats CompileCache::loadStats() const {
+    CacheStats stats;
+    std::ifstream in(fs::path(directory) / "stats");
+    std::string name;
+    uint64_t value;
+    while (in >> name >> value) {
+        if (name == "hits") stats.hits = value;
+        else if (name == "misses") stats.misses = value;
+        else if (name == "bytes_saved") stats.bytesSaved = value;
+        else if (name == "evictions") stats.evictions = value;
+    }
+    return stats;
+}
+
+uint64_t CompileCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return currentBytes;
+}
+
+CacheStats CompileCache::totals() const {
+    CacheStats stats = loadStats();
+    stats.hits += session.hits;
+    stats.misses += session.misses;
+    stats.bytesSaved += session.bytesSaved;
+    stats.evictions += session.evictions;
+    return stats;
+}
+
+void CompileCache::saveStats() const {
+    if (session.hits == 0 && session.misses == 0 && session.evictions == 0)
+        return;
+
+    CacheStats stats = totals();
+    fs::path path = fs::path(directory) / "stats";
+    fs::path staging = path;
+    staging += ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(staging);
+        out << "hits " << stats.hits << "\n"
+            << "misses " << stats.misses << "\n"
+            << "bytes_saved " << stats.bytesSaved << "\n"
+            << "evictions " << stats.evictions << "\n";
+    }
+    fs::rename(staging, path);
+}
+
+void CompileCache::clear() {
+    std::error_code ec;
+    fs::remove_all(fs::path(directory) / "objects", ec);
+    fs::remove(fs::path(directory) / "stats", ec);
+    fs::create_directories(fs::path(directory) / "objects", ec);
+    currentBytes = 0;
+    session = CacheStats();
+}
@@ -0,0 +1,62 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+struct CompileOptions;
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t bytesSaved = 0;
+    uint64_t evictions = 0;
+};
+
+// Content-addressed store of compiled outputs. Entries are keyed by a hash
+// of the input bytes, the star version, the contract set declared in the
+// input and the options that affect code generation, so a hit can skip the
+// whole pipeline. The store is kept under maxBytes by evicting the least
+// recently used entries.
+class CompileCache {
+public:
+    CompileCache(const std::string& directory, uint64_t maxBytes);
+    ~CompileCache();
+
+    CompileCache(const CompileCache&) = delete;
+    CompileCache& operator=(const CompileCache&) = delete;
+
+    std::string key(const std::string& source, const CompileOptions& options) const;
+
+    // Reads the entry for key, a whole file's output or an incremental
+    // fragment, into contents. Returns false on a miss.
+    bool lookup(const std::string& key, std::string& contents);
+
+    void insert(const std::string& key, const std::string& contents);
+
+    // Totals persisted across runs, including this process.
+    CacheStats totals() const;
+
+    // Bytes currently held in the store.
+    uint64_t size() const;
+
+    void clear();
+
+    static std::string defaultDirectory();
+
+private:
+    mutable std::mutex mutex;   // one caller at a time, for -j
+    std::string directory;
+    uint64_t maxBytes;
+    uint64_t currentBytes;
+    CacheStats session;
+
+    std::string entryPath(const std::string& key) const;
+    CacheStats loadStats() const;
+    void saveStats() const;
+    void evict();
+    void commit(const std::string& key, const std::string& staging);
+};
+
+#endif
@@ -0,0 +1,511 @@
+#include <initializer_list>
+
+#include "checks.h"
+#include "nativeparse.h"
+
+namespace {
+
+typedef std::vector<ParseNode*> Tokens;
+
+// Enforcement state shared by every compiled file. .star_guard() counts the
+// calls of each function so that "first" and "sample:N" need no global
+// counter; star_enforce() resets the counts.
+const char* const runtimePrelude = R"(
+if (!exists(".star", inherits = FALSE)) {
+    .star <- new.env()
+    star_enforce <- function(level = getOption("star.enforce", Sys.getenv("STAR_ENFORCE", "full"))) {
+        if (!nzchar(level)) level <- "full"
+        every <- 1L
+        if (startsWith(level, "sample:")) {
+            every <- suppressWarnings(as.integer(substring(level, 8)))
+            if (is.na(every) || every < 1L) stop("Invalid star enforcement level: ", level)
+        } else if (!level %in% c("off", "first", "full")) {
+            stop("Invalid star enforcement level: ", level)
+        }
+        assign("full", level == "full", envir = .star)
+        assign("partial", level == "first" || startsWith(level, "sample:"), envir = .star)
+        assign("first", level == "first", envir = .star)
+        assign("every", every, envir = .star)
+        assign("calls", new.env(hash = TRUE), envir = .star)
+        invisible(level)
+    }
+    .star_guard <- function(name) {
+        calls <- .star$calls[[name]]
+        if (is.null(calls)) calls <- 0L
+        assign(name, if (.star$first) 1L else (calls + 1L) %% .star$every, envir = .star$calls)
+        calls == 0L
+    }
+    star_enforce()
+}
+)";
+
+#ifndef STAR_CHECKS_LIB
+#define STAR_CHECKS_LIB "starchecks.so"
+#endif
+
+// Loads the native check library (see runtime/starchecks.c) for files
+// compiled with --native-checks or --memo-checks, unless a file already did.
+const char* const nativeLoader = R"(
+if (!exists(".star_checks_dll", inherits = FALSE))
+    .star_checks_dll <- dyn.load(getOption("star.checks.lib", Sys.getenv("STAR_CHECKS_LIB", .library)))
+)";
+
+// Binds .star_check to the native check routine for --native-checks.
+const char* const nativeBinding = R"(
+if (!exists(".star_check", inherits = FALSE))
+    .star_check <- getNativeSymbolInfo("star_check", .star_checks_dll)
+)";
+
+// The --memo-checks cache, which lives in the native check library. Its
+// hit and miss counts are printed at exit when the star.cache.report
+// option or STAR_CACHE_REPORT is set.
+const char* const memoCache = R"(
+if (!exists(".star_seen", inherits = FALSE)) {
+    .star_seen <- getNativeSymbolInfo("star_memo_seen", .star_checks_dll)
+    .star_remember <- getNativeSymbolInfo("star_memo_remember", .star_checks_dll)
+    star_cache <- function(size = getOption("star.cache.size", 16L)) {
+        .Call(getNativeSymbolInfo("star_memo_reset", .star_checks_dll), as.integer(size))
+        invisible(size)
+    }
+    star_cache_stats <- function() {
+        counts <- .Call(getNativeSymbolInfo("star_memo_stats", .star_checks_dll))
+        stats <- data.frame(type = counts[[1L]], hits = counts[[2L]], misses = counts[[3L]])
+        stats <- stats[order(stats$type), , drop = FALSE]
+        row.names(stats) <- NULL
+        stats
+    }
+    .star_memo <- new.env()
+    reg.finalizer(.star_memo, function(memo) {
+        stats <- star_cache_stats()
+        if (nrow(stats) && (isTRUE(getOption("star.cache.report")) || nzchar(Sys.getenv("STAR_CACHE_REPORT"))))
+            message(paste(capture.output(print(stats)), collapse = "\n"))
+    }, onexit = TRUE)
+    star_cache()
+}
+)";
+
+// Counters behind --profile-checks. Every profiled check is keyed by
+// function, argument ("return" for output checks) and type, joined with
+// tabs. .star_profile_begin() counts the call and reads the clock last,
+// .star_profile_end() reads it first, so their own cost stays out of the
+// check time. A check that fails never reaches .star_profile_end(), which
+// makes failures the calls that did not finish. The summary is written at
+// exit, most expensive check first.
+const char* const checkProfiler = R"(
+if (!exists(".star_profile", inherits = FALSE)) {
+    .star_profile <- new.env(hash = TRUE)
+    .star_profile_begin <- function(key) {
+        counts <- .star_profile[[key]]
+        if (is.null(counts)) counts <- c(0, 0, 0)
+        counts[[1L]] <- counts[[1L]] + 1
+        assign(key, counts, envir = .star_profile)
+        unclass(Sys.time())
+    }
+    .star_profile_end <- function(key, start) {
+        now <- unclass(Sys.time())
+        counts <- .star_profile[[key]]
+        counts[[2L]] <- counts[[2L]] + 1
+        counts[[3L]] <- counts[[3L]] + (now - start)
+        assign(key, counts, envir = .star_profile)
+    }
+    star_profile_stats <- function() {
+        keys <- ls(.star_profile, all.names = TRUE)
+        counts <- vapply(keys, function(key) .star_profile[[key]], numeric(3))
+        parts <- strsplit(keys, "\t", fixed = TRUE)
+        stats <- data.frame(name = vapply(parts, `[`, "", 1L), argument = vapply(parts, `[`, "", 2L),
+                            type = vapply(parts, `[`, "", 3L), calls = counts[1, ], failures = counts[1, ] - counts[2, ],
+                            seconds = counts[3, ], mean_us = 1e6 * counts[3, ] / pmax(counts[2, ], 1), row.names = NULL)
+        names(stats)[[1L]] <- "function"
+        stats[order(-stats$seconds), , drop = FALSE]
+    }
+    reg.finalizer(.star_profile, function(profile) {
+        if (length(ls(profile, all.names = TRUE)))
+            write.table(star_profile_stats(), getOption("star.profile.file", Sys.getenv("STAR_PROFILE_FILE", "star-profile.tsv")),
+                        sep = "\t", quote = FALSE, row.names = FALSE)
+    }, onexit = TRUE)
+}
+)";
+
+// A hole in a template is a symbol whose name starts with '.', filled
+// with a token sequence when the template is instantiated.
+struct Hole {
+    std::string_view name;
+    Tokens tokens;
+};
+
+class Template {
+public:
+    Template(const char* source, ParseArena& arena) : tokens(terminalTokens(nativeParseSource(source, arena))) {
+        for (ParseNode* token : tokens)
+            token->id = 0;
+        // Where the template itself begins depends on where it is used;
+        // callers separate consecutive statements with ';'.
+        tokens.front()->startsStatement = false;
+    }
+
+    Tokens instantiate(std::initializer_list<Hole> holes, ParseArena& arena) const {
+        Tokens result;
+        result.reserve(tokens.size() + 8);
+        for (ParseNode* token : tokens) {
+            const Hole* hole = nullptr;
+            if (token->kind == TokenKind::Symbol || token->kind == TokenKind::SymbolFunctionCall) {
+                for (const Hole& candidate : holes) {
+                    if (candidate.name == token->text)
+                        hole = &candidate;
+                }
+            }
+
+            if (!hole) {
+                result.push_back(token);
+            } else if (hole->tokens.size() == 1 && hole->tokens[0]->kind == TokenKind::Symbol &&
+                       token->kind != TokenKind::Symbol) {
+                // A name substituted in call position becomes the call symbol.
+                ParseNode* name = arena.makeNode(0, 0, token->token, hole->tokens[0]->text);
+                result.push_back(name);
+            } else {
+                result.insert(result.end(), hole->tokens.begin(), hole->tokens.end());
+            }
+        }
+        return result;
+    }
+
+private:
+    Tokens tokens;
+};
+
+struct Templates {
+    ParseArena arena;
+    Template scalar{".is(.value)", arena};
+    Template dataFrame{"is.data.frame(.value)", arena};
+    Template atomicVector{".is(.value) || is.list(.value) && all(vapply(.value, .element, logical(1)))", arena};
+    Template vector{"is.vector(.value) && all(vapply(.value, .element, logical(1)))", arena};
+    Template list{"is.list(.value) && all(vapply(.value, .element, logical(1)))", arena};
+    Template elementFunction{"function(element) .check", arena};
+    Template classes{"inherits(.value, .classes)", arena};
+    Template either{".left || .right", arena};
+    Template stopIfNot{"stopifnot(.check)", arena};
+    Template memoized{"if (!.Call(.star_seen, .value, .type)) { .check; .Call(.star_remember, .value, .type) }", arena};
+    Template outputCheck{"if (!.check) stop(.message)", arena};
+    Template outputCheckCompound{"if (!(.check)) stop(.message)", arena};
+    Template returnValue{"return(outputTypecheckExpression)", arena};
+    Template combine{"c(.values)", arena};
+    Template condition{".star$full || .star$partial && .star_guard(.name)", arena};
+    Template guard{".star_checking <- .condition", arena};
+    Template guarded{"if (.condition) .check", arena};
+    Template guardedBlock{"if (.condition) { .checks }", arena};
+    Template nativeCheck{".Call(.star_check, .value, .spec, .message)", arena};
+    Template profiled{"{ .star_t <- .star_profile_begin(.key); .check; .star_profile_end(.key, .star_t) }", arena};
+    Template prelude{runtimePrelude, arena};
+    Template loader{nativeLoader, arena};
+    Template binding{nativeBinding, arena};
+    Template memo{memoCache, arena};
+    Template profiler{checkProfiler, arena};
+};
+
+const Templates& templates() {
+    static const Templates instance;
+    return instance;
+}
+
+struct Predicate {
+    Tokens tokens;
+    bool compound; // needs parentheses under '!'
+};
+
+Tokens symbol(std::string_view name, ParseArena& arena) {
+    return {arena.makeNode(0, 0, "SYMBOL", name)};
+}
+
+// ';' between two statements, which the formatter turns into a line break.
+ParseNode* separator(ParseArena& arena) {
+    return arena.makeNode(0, 0, "';'", ";");
+}
+
+Tokens stringConstant(const std::string& value, ParseArena& arena) {
+    return {arena.makeNode(0, 0, "STR_CONST", "'" + value + "'")};
+}
+
+Predicate predicate(const Type* type, const Tokens& value, ParseArena& arena);
+
+// The atomic type an element of T[] may take when the vector is atomic, or
+// "" if such vectors must be lists. Atomic vectors never hold NULL, so a
+// nullable element type counts as its base type.
+std::string atomicElementName(const Type* element) {
+    if (element->isNullable())
+        element = static_cast<const NullableType*>(element)->getBaseType();
+    if (!element->isScalar())
+        return "";
+    std::string name = element->toString();
+    return TypeLattice::isAtomic(name) ? name : "";
+}
+
+// Whether the check of type reads nothing but the type, attributes and
+// length of the value and of the list elements below it, all of which the
+// memo cache's stamp covers. A user-defined is.T() may read the values.
+bool structural(const Type* type) {
+    if (type->isVector())
+        return structural(static_cast<const VectorType*>(type)->getBaseType());
+    if (type->isList())
+        return structural(static_cast<const ListType*>(type)->getElementType());
+    if (type->isNullable())
+        return structural(static_cast<const NullableType*>(type)->getBaseType());
+    if (type->isUnion()) {
+        const auto* both = static_cast<const UnionType*>(type);
+        return structural(both->getLeftType()) && structural(both->getRightType());
+    }
+    if (type->isClass() || type->isFunction() || type->isEnvironment())
+        return true;
+    std::string name = type->toString();
+    return TypeLattice::isAtomic(name) || name == "list" || name == "null" || name == "dataframe";
+}
+
+// Whether checking type visits the elements of a list one by one.
+bool elementWise(const Type* type) {
+    if (type->isVector())
+        return atomicElementName(static_cast<const VectorType*>(type)->getBaseType()).empty();
+    if (type->isList())
+        return true;
+    if (type->isNullable())
+        return elementWise(static_cast<const NullableType*>(type)->getBaseType());
+    if (type->isUnion()) {
+        const auto* both = static_cast<const UnionType*>(type);
+        return elementWise(both->getLeftType()) || elementWise(both->getRightType());
+    }
+    return false;
+}
+
+// Checks worth a memo lookup: element-wise ones, and data frames, which
+// are typically passed unchanged through a chain of contracted functions.
+// A single is.T() or inherits() costs no more than the lookup.
+bool memoizable(const Type* type) {
+    return structural(type) && (elementWise(type) || type->toString() == "dataframe");
+}
+
+// Function applied to each element by vapply(): a plain is.T for scalar
+// element types, an anonymous function for everything else.
+Tokens elementCheck(const Type* type, ParseArena& arena) {
+    const Templates& t = templates();
+    if (type->isScalar() && type->toString() != "dataframe")
+        return symbol("is." + type->toString(), arena);
+    Predicate inner = predicate(type, symbol("element", arena), arena);
+    return t.elementFunction.instantiate({{".check", inner.tokens}}, arena);
+}
+
+Predicate predicate(const Type* type, const Tokens& value, ParseArena& arena) {
+    const Templates& t = templates();
+
+    if (type->isVector()) {
+        const Type* base = static_cast<const VectorType*>(type)->getBaseType();
+        // is.T() on an atomic vector reads its SEXP type and never visits
+        // the elements; only lists are checked one element at a time.
+        std::string atomic = atomicElementName(base);
+        if (!atomic.empty())
+            return {t.atomicVector.instantiate({{".is", symbol("is." + atomic, arena)}, {".value", value},
+                                                {".element", elementCheck(base, arena)}},
+                                               arena),
+                    true};
+        return {t.vector.instantiate({{".value", value}, {".element", elementCheck(base, arena)}}, arena), true};
+    }
+    if (type->isList()) {
+        const Type* element = static_cast<const ListType*>(type)->getElementType();
+        return {t.list.instantiate({{".value", value}, {".element", elementCheck(element, arena)}}, arena), true};
+    }
+    if (type->isClass()) {
+        const std::vector<std::string>& ids = static_cast<const ClassType*>(type)->getClassIDs();
+        Tokens names;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (i > 0)
+                names.push_back(arena.makeNode(0, 0, "','", ","));
+            Tokens name = stringConstant(ids[i], arena);
+            names.insert(names.end(), name.begin(), name.end());
+        }
+        Tokens classes = ids.size() == 1 ? names : t.combine.instantiate({{".values", names}}, arena);
+        return {t.classes.instantiate({{".value", value}, {".classes", classes}}, arena), false};
+    }
+    if (type->isNullable() || type->isUnion()) {
+        // One test per member of the normalized union, so that T | T? or
+        // integer | numeric check no more than the lattice requires.
+        std::vector<const Type*> members = TypeLattice::members(type);
+        Predicate check = predicate(members.back(), value, arena);
+        for (size_t i = members.size() - 1; i-- > 0;) {
+            Predicate left = predicate(members[i], value, arena);
+            check = {t.either.instantiate({{".left", left.tokens}, {".right", check.tokens}}, arena), true};
+        }
+        return check;
+    }
+
+    std::string name;
+    if (type->isFunction())
+        name = "function";
+    else if (type->isEnvironment())
+        name = "environment";
+    else
+        name = type->toString();
+
+    if (name == "dataframe")
+        return {t.dataFrame.instantiate({{".value", value}}, arena), false};
+    return {t.scalar.instantiate({{".is", symbol("is." + name, arena)}, {".value", value}}, arena), false};
+}
+
+// Appends the native library's prefix form of type (see
+// runtime/starchecks.c) to spec. False if some part of type has no native
+// check, such as a user-defined is.T().
+bool nativeSpec(const Type* type, std::string& spec) {
+    auto token = [&spec](const std::string& text) {
+        if (!spec.empty())
+            spec += ' ';
+        spec += text;
+    };
+
+    if (type->isNullable() || type->isUnion()) {
+        std::vector<const Type*> members = TypeLattice::members(type);
+        if (members.size() > 1) {
+            token("|");
+            token(std::to_string(members.size()));
+        }
+        for (const Type* member : members) {
+            if (!nativeSpec(member, spec))
+                return false;
+        }
+        return true;
+    }
+    if (type->isVector()) {
+        const Type* base = static_cast<const VectorType*>(type)->getBaseType();
+        std::string atomic = atomicElementName(base);
+        token("[");
+        token(atomic.empty() ? "-" : atomic);
+        return nativeSpec(base, spec);
+    }
+    if (type->isList()) {
+        token("list<");
+        return nativeSpec(static_cast<const ListType*>(type)->getElementType(), spec);
+    }
+    if (type->isClass()) {
+        const std::vector<std::string>& ids = static_cast<const ClassType*>(type)->getClassIDs();
+        token("class");
+        token(std::to_string(ids.size()));
+        for (const std::string& id : ids)
+            token(id);
+        return !ids.empty();
+    }
+    if (type->isFunction() || type->isEnvironment()) {
+        token(type->isFunction() ? "function" : "environment");
+        return true;
+    }
+
+    if (!type->isScalar())
+        return false;
+    static const char* const names[] = {"logical", "integer", "double", "numeric", "complex", "character", "raw",
+                                        "null", "list", "dataframe", "function", "environment"};
+    const std::string& name = static_cast<const ScalarType*>(type)->getName();
+    for (const char* known : names) {
+        if (name == known) {
+            token(name);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string typeMessage(const std::string& subject, const Type* type) {
+    std::string typeName = type->toString();
+    return typeName == "dataframe" ? subject + " must be a data frame" : subject + " must be of type " + typeName;
+}
+
+// check, timed by the profiler under functionName, what and type.
+Tokens profiledCheck(const Tokens& check, std::string_view functionName, std::string_view what, const Type* type,
+                     ParseArena& arena) {
+    std::string key = std::string(functionName) + "\\t" + std::string(what) + "\\t" + type->toString();
+    return templates().profiled.instantiate({{".key", stringConstant(key, arena)}, {".check", check}}, arena);
+}
+
+} // namespace
+
+std::vector<ParseNode*> argumentCheckTokens(const Type* type, std::string_view argName, bool memoize, bool native,
+                                            std::string_view profiledFunction, ParseArena& arena) {
+    const Templates& t = templates();
+    Tokens value = symbol(argName, arena);
+    std::string spec;
+    Tokens statement;
+    bool checkedNatively = native && nativeSpec(type, spec);
+    if (checkedNatively) {
+        std::string message = typeMessage("Argument " + std::string(argName), type);
+        statement = t.nativeCheck.instantiate({{".value", value}, {".spec", stringConstant(spec, arena)},
+                                               {".message", stringConstant(message, arena)}},
+                                              arena);
+    } else {
+        Predicate check = predicate(type, value, arena);
+        statement = t.stopIfNot.instantiate({{".check", check.tokens}}, arena);
+    }
+    // A native check walks the elements in C, as the memo stamp would.
+    if (memoize && !checkedNatively && memoizable(type))
+        statement = t.memoized.instantiate(
+            {{".value", value}, {".type", stringConstant(type->toString(), arena)}, {".check", statement}}, arena);
+    if (!profiledFunction.empty())
+        statement = profiledCheck(statement, profiledFunction, argName, type, arena);
+    return statement;
+}
+
+std::vector<ParseNode*> returnCheckTokens(const Type* type, const std::vector<ParseNode*>& condition, bool native,
+                                          std::string_view profiledFunction, ParseArena& arena) {
+    const Templates& t = templates();
+    Tokens value = symbol("outputTypecheckExpression", arena);
+    Tokens message = stringConstant(typeMessage("Output", type), arena);
+
+    std::string spec;
+    Tokens tokens;
+    if (native && nativeSpec(type, spec)) {
+        tokens = t.nativeCheck.instantiate(
+            {{".value", value}, {".spec", stringConstant(spec, arena)}, {".message", message}}, arena);
+    } else {
+        Predicate check = predicate(type, value, arena);
+        const Template& statement = check.compound ? t.outputCheckCompound : t.outputCheck;
+        tokens = statement.instantiate({{".check", check.tokens}, {".message", message}}, arena);
+    }
+    if (!profiledFunction.empty())
+        tokens = profiledCheck(tokens, profiledFunction, "return", type, arena);
+    if (!condition.empty())
+        tokens = t.guarded.instantiate({{".condition", condition}, {".check", tokens}}, arena);
+    Tokens result = t.returnValue.instantiate({}, arena);
+    tokens.push_back(separator(arena));
+    tokens.insert(tokens.end(), result.begin(), result.end());
+    return tokens;
+}
+
+std::vector<ParseNode*> enforcementCondition(std::string_view functionName, ParseArena& arena) {
+    return templates().condition.instantiate({{".name", stringConstant(std::string(functionName), arena)}}, arena);
+}
+
+std::vector<ParseNode*> guardTokens(std::string_view functionName, ParseArena& arena) {
+    return templates().guard.instantiate({{".condition", enforcementCondition(functionName, arena)}}, arena);
+}
+
+std::vector<ParseNode*> guardVariable(ParseArena& arena) {
+    return symbol(".star_checking", arena);
+}
+
+std::vector<ParseNode*> guardedTokens(const std::vector<ParseNode*>& condition,
+                                      const std::vector<ParseNode*>& statements, bool block, ParseArena& arena) {
+    const Templates& t = templates();
+    if (block)
+        return t.guardedBlock.instantiate({{".condition", condition}, {".checks", statements}}, arena);
+    return t.guarded.instantiate({{".condition", condition}, {".check", statements}}, arena);
+}
+
+std::vector<ParseNode*> runtimePreludeTokens(bool native, bool memoize, bool profile, ParseArena& arena) {
+    const Templates& t = templates();
+    Tokens tokens = t.prelude.instantiate({}, arena);
+    auto append = [&](const Tokens& part) {
+        tokens.push_back(separator(arena));
+        tokens.insert(tokens.end(), part.begin(), part.end());
+    };
+    if (native || memoize)
+        append(t.loader.instantiate({{".library", stringConstant(STAR_CHECKS_LIB, arena)}}, arena));
+    if (native)
+        append(t.binding.instantiate({}, arena));
+    if (memoize)
+        append(t.memo.instantiate({}, arena));
+    if (profile)
+        append(t.profiler.instantiate({}, arena));
+    return tokens;
+}
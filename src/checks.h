@@ -0,0 +1,67 @@
+#ifndef CHECKS_H
+#define CHECKS_H
+
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "typelang.h"
+
+// Runtime type checks as ready-made token sequences. Each type kind
+// (scalar, vector, list, class, nullable, union, data frame ...) has a
+// template that is tokenized once, on first use, by the native lexer.
+// Building a check copies template tokens and substitutes argument names
+// and nested checks as tokens, so injecting checks never runs a parser.
+// New tokens are allocated in arena; template tokens are shared.
+
+// stopifnot(...) asserting that argName has type. With memoize, a check
+// that visits list elements one by one is skipped for an unchanged object
+// that already passed it (see the memo cache in runtime/starchecks.c). With native,
+// types the native check library covers are checked by a .Call() into it
+// instead (see runtime/starchecks.c). Unless profiledFunction is empty,
+// the check is counted and timed by the check profiler under that function,
+// argName and type (see runtimePreludeTokens()).
+std::vector<ParseNode*> argumentCheckTokens(const Type* type, std::string_view argName, bool memoize, bool native,
+                                            std::string_view profiledFunction, ParseArena& arena);
+
+// if (...) stop(...) asserting that outputTypecheckExpression has type,
+// followed by return(outputTypecheckExpression). The check only runs when
+// condition holds, unless condition is empty. native and profiledFunction
+// as above; return checks are profiled as argument "return".
+std::vector<ParseNode*> returnCheckTokens(const Type* type, const std::vector<ParseNode*>& condition, bool native,
+                                          std::string_view profiledFunction, ParseArena& arena);
+
+// Runtime enforcement. The prelude defines star_enforce(level), which reads
+// the star.enforce option or the STAR_ENFORCE environment variable by
+// default: "full" checks every call, "first" only the first call of each
+// function, "sample:N" every Nth call and "off" none. A function decides
+// once, on entry, whether this call is checked and keeps the answer in
+// .star_checking, so that a disabled level costs two lookups per call.
+
+// The enforcement decision for one call of functionName.
+std::vector<ParseNode*> enforcementCondition(std::string_view functionName, ParseArena& arena);
+
+// .star_checking <- enforcementCondition(functionName)
+std::vector<ParseNode*> guardTokens(std::string_view functionName, ParseArena& arena);
+
+// .star_checking, as a condition.
+std::vector<ParseNode*> guardVariable(ParseArena& arena);
+
+// if (condition) statements, with the statements braced when block is set.
+std::vector<ParseNode*> guardedTokens(const std::vector<ParseNode*>& condition,
+                                      const std::vector<ParseNode*>& statements, bool block, ParseArena& arena);
+
+// Definitions of .star, star_enforce() and .star_guard(); files that use
+// guards start with it. It is skipped when an earlier file already ran it.
+// With native or memoize, it also loads the native check library from the
+// star.checks.lib option, the STAR_CHECKS_LIB environment variable or the
+// library star was built with. native binds .star_check; memoize defines
+// the memo cache, star_cache(size) to empty it and star_cache_stats() for
+// its hit and miss counts per type. With profile, it also defines the
+// check profiler, which writes the calls, failures and total time of every
+// profiled check as a tab separated table at exit, to the
+// star.profile.file option, the STAR_PROFILE_FILE environment variable or
+// star-profile.tsv; star_profile_stats() returns the same table.
+std::vector<ParseNode*> runtimePreludeTokens(bool native, bool memoize, bool profile, ParseArena& arena);
+
+#endif
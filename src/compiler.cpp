@@ -0,0 +1,422 @@
+// compiler.cpp
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <cerrno>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <optional>
+
+#include <R.h>
+#include <R_ext/Rdynload.h>
+#include <Rinternals.h>
+#include <Rembedded.h>
+#include <R_ext/Parse.h>
+
+#undef length
+
+#include "parse.h"
+#include "typelang.h"
+#include "gensource.h"
+#include "compiler.h"
+#include "nativeparse.h"
+#include "format.h"
+#include "cache.h"
+#include "incremental.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "stream.h"
+#include "timings.h"
+
+bool startsWith(const std::string &str, const char *prefix)
+{
+    size_t lenPrefix = std::strlen(prefix);
+    return str.size() >= lenPrefix && std::strncmp(str.c_str(), prefix, lenPrefix) == 0;
+}
+
+std::vector<std::string> contractLines(const std::string &source)
+{
+    std::vector<std::string> contracts;
+    std::istringstream in(source);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!startsWith(line, "# @contract"))
+            continue;
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        contracts.push_back(line);
+    }
+    return contracts;
+}
+
+std::vector<ParseNode *> generateASTFromSource(const std::string &code, Frontend frontend, ParseArena &arena)
+{
+    if (frontend == Frontend::Native)
+        return nativeParseSource(code, arena);
+
+    std::vector<ParseNode *> roots;
+    runOnOwnerThread([&] { roots = parseRSource(code, "<check>", arena); });
+    if (roots.empty())
+        throw std::runtime_error("Failed to parse the provided R code.");
+    return roots;
+}
+
+bool parseFrontend(const std::string &name, Frontend &frontend)
+{
+    if (name == "r")
+        frontend = Frontend::R;
+    else if (name == "native")
+        frontend = Frontend::Native;
+    else if (name == "compare")
+        frontend = Frontend::Compare;
+    else
+        return false;
+    return true;
+}
+
+std::vector<ParseNode *> parseSource(const std::string &source, const char *name, Frontend frontend,
+                                     ParseArena &arena)
+{
+    if (frontend == Frontend::Native)
+    {
+        try
+        {
+            return nativeParseSource(source, arena);
+        }
+        catch (const std::exception &e)
+        {
+            throw std::runtime_error(std::string(name) + ": " + e.what());
+        }
+    }
+
+    // The embedded R session only runs on its own thread.
+    std::vector<ParseNode *> roots;
+    runOnOwnerThread([&] { roots = parseRSource(source, name, arena); });
+    return roots;
+}
+
+std::vector<ParseNode *> parseFile(const char *filename, Frontend frontend, ParseArena &arena)
+{
+    if (frontend == Frontend::Native)
+        return nativeParseFile(filename, arena);
+
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return {};
+    }
+    std::ostringstream source;
+    source << in.rdbuf();
+    return parseRSource(source.str(), filename, arena);
+}
+
+void loadContracts(const std::string &source)
+{
+    TypeParser::functionContracts.clear();
+    for (const std::string &line : contractLines(source))
+    {
+        std::string contractLine = line.substr(11);
+        contractLine.erase(0, contractLine.find_first_not_of(" \t"));
+
+        std::istringstream iss(contractLine);
+        std::string functionName;
+        iss >> functionName;
+        std::string typeExpr;
+        std::getline(iss, typeExpr);
+        typeExpr.erase(0, typeExpr.find_first_not_of(" \t"));
+
+        try
+        {
+            TypeParser parser(typeExpr);
+            if (auto *funcType = dynamic_cast<const FunctionType *>(parser.parseType()))
+            {
+                TypeParser::addFunctionContract(functionName, {.argTypes = funcType->arguments,
+                                                               .returnType = funcType->returnType});
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Contract parse error: " << e.what() << std::endl;
+        }
+    }
+}
+
+static bool compileUncached(const std::string &source, std::string &output, const CompileOptions &options,
+                            const char *name)
+{
+    CompilationUnit unit;
+    unit.name = name;
+    unit.source = source;
+
+    std::vector<PassTiming> timings;
+    bool ok = runPasses(unit, options, options.passTimings || options.timings ? &timings : nullptr);
+    if (options.passTimings)
+    {
+        std::cerr << "Pass timings for " << name << ":" << std::endl;
+        printPassTimings(timings);
+    }
+    if (options.timings)
+    {
+        FileTimings &file = options.timings->file(name);
+        file.phases.insert(file.phases.end(), timings.begin(), timings.end());
+        file.nodes = unit.tree.size();
+        file.tokens = 0;
+        for (size_t row = 0; row < unit.tree.size(); ++row)
+            file.tokens += unit.tree.isTerminal(static_cast<int>(row));
+        file.arena = unit.arena.stats();
+    }
+    if (!ok)
+        return false;
+
+    output = std::move(unit.output);
+    return true;
+}
+
+bool compileSource(const std::string &source, std::string &output, const CompileOptions &options, const char *name)
+{
+    if (!options.cache)
+        return compileUncached(source, output, options, name);
+
+    std::optional<PhaseClock> lookupClock;
+    if (options.timings)
+        lookupClock.emplace();
+    std::string key = options.cache->key(source, options);
+    bool hit = options.cache->lookup(key, output);
+    if (options.timings)
+    {
+        FileTimings &file = options.timings->file(name);
+        file.phases.push_back(lookupClock->stop("cache lookup"));
+        file.cached = hit;
+    }
+    if (hit)
+        return true;
+
+    if (options.incremental)
+    {
+        std::optional<PhaseClock> clock;
+        if (options.timings)
+            clock.emplace();
+        IncrementalReport report;
+        bool ok = compileIncremental(source, output, options, report);
+        if (options.timings)
+            options.timings->file(name).phases.push_back(clock->stop("incremental"));
+        if (!ok)
+            return false;
+
+        std::cerr << "Recompiled " << report.recompiled << " of " << report.fragments
+                  << " top-level expressions" << std::endl;
+    }
+    else if (!compileUncached(source, output, options, name))
+    {
+        return false;
+    }
+
+    options.cache->insert(key, output);
+    return true;
+}
+
+// compileFile() with options.streaming: output is written as it is compiled
+// and not echoed.
+static bool compileFileStreaming(const char *filename, const char *outputPath, const CompileOptions &options,
+                                 std::ostream &echo)
+{
+    std::optional<PhaseClock> clock;
+    if (options.timings)
+        clock.emplace();
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return false;
+    }
+    echo << "Writing to file: " << outputPath << std::endl;
+    std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Error: Cannot open output file " << outputPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool compiled = compileStream(in, out, options, filename);
+    out.flush();
+    if (options.timings)
+    {
+        FileTimings &file = options.timings->file(filename);
+        file.phases.push_back(clock->stop("stream"));
+        in.clear();
+        file.bytesRead = static_cast<size_t>(in.tellg());
+        file.bytesWritten = static_cast<size_t>(out.tellp());
+        file.peakRssKb = peakRssKb();
+    }
+    return compiled && out;
+}
+
+bool compileFile(const char *filename, const char *outputPath, const CompileOptions &options, std::ostream &echo)
+{
+    if (options.streaming)
+        return compileFileStreaming(filename, outputPath, options, echo);
+
+    std::optional<PhaseClock> readClock;
+    if (options.timings)
+        readClock.emplace();
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return false;
+    }
+    std::ostringstream source;
+    source << in.rdbuf();
+
+    FileTimings *timings = nullptr;
+    if (options.timings)
+    {
+        timings = &options.timings->file(filename);
+        timings->phases.push_back(readClock->stop("read"));
+        timings->bytesRead = static_cast<size_t>(source.tellp());
+    }
+
+    std::string output;
+    bool compiled = compileSource(source.str(), output, options, filename);
+    if (timings)
+        timings->peakRssKb = peakRssKb();
+    if (!compiled)
+        return false;
+
+    std::optional<PhaseClock> writeClock;
+    if (timings)
+        writeClock.emplace();
+    echo << "Writing to file: " << outputPath << std::endl;
+    int fd = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Error: Cannot open output file " << outputPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    echo << output;
+    bool written = write(fd, output.data(), output.size()) == static_cast<ssize_t>(output.size());
+    close(fd);
+    if (timings)
+    {
+        timings->phases.push_back(writeClock->stop("write"));
+        timings->bytesWritten = written ? output.size() : 0;
+    }
+    return written;
+}
+
+static double timeParse(const char *filename, Frontend frontend, std::string &canonical)
+{
+    ParseArena arena;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ParseNode *> roots = parseFile(filename, frontend, arena);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    canonical = canonicalAST(roots);
+    return ms;
+}
+
+bool compareFrontends(const char *filename)
+{
+    std::string fromR, fromNative;
+    double rMs = timeParse(filename, Frontend::R, fromR);
+    double nativeMs = timeParse(filename, Frontend::Native, fromNative);
+
+    std::cout << "R front end:      " << rMs << " ms" << std::endl;
+    std::cout << "native front end: " << nativeMs << " ms";
+    if (nativeMs > 0.0)
+        std::cout << " (" << rMs / nativeMs << "x)";
+    std::cout << std::endl;
+
+    if (fromR == fromNative)
+    {
+        std::cout << "Front ends agree." << std::endl;
+        return true;
+    }
+
+    std::istringstream r(fromR), native(fromNative);
+    std::string rLine, nativeLine;
+    for (size_t lineNo = 1;; ++lineNo)
+    {
+        bool moreR = static_cast<bool>(std::getline(r, rLine));
+        bool moreNative = static_cast<bool>(std::getline(native, nativeLine));
+        if (!moreR && !moreNative)
+            break;
+        if (!moreR || !moreNative || rLine != nativeLine)
+        {
+            std::cout << "Front ends differ at node " << lineNo << ":" << std::endl;
+            std::cout << "  R:      " << (moreR ? rLine : "<end>") << std::endl;
+            std::cout << "  native: " << (moreNative ? nativeLine : "<end>") << std::endl;
+            break;
+        }
+    }
+    return false;
+}
+
+// A statement of about 25 tokens, numbered so that identifiers differ.
+static std::string syntheticStatement(size_t i)
+{
+    std::string n = std::to_string(i);
+    return "v" + n + " <- fn(a" + n + " * 2, \"s\", b = c(1, 2)) + x$y[[" + n + "]]\n" +
+           "if (v" + n + " > 0) w <- -v" + n + "\n";
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool benchTreeBuilders(size_t maxTokens)
+{
+    ParseArena probe;
+    size_t tokensPerStatement = terminalTokens(nativeParseSource(syntheticStatement(0), probe)).size();
+
+    bool agree = true;
+    std::cout << "tokens      R parse ms  data.frame ms  raw ms   speedup" << std::endl;
+    for (size_t target = 1000; target <= maxTokens; target *= 10)
+    {
+        std::string source;
+        for (size_t i = 0; i * tokensPerStatement < target; ++i)
+            source += syntheticStatement(i);
+
+        auto start = std::chrono::steady_clock::now();
+        SEXP srcfile = PROTECT(parseIntoSrcfile(source, "<bench>"));
+        double parseMs = millisecondsSince(start);
+        if (srcfile == R_NilValue)
+        {
+            UNPROTECT(1);
+            return false;
+        }
+
+        ParseArena viaFrame;
+        start = std::chrono::steady_clock::now();
+        SEXP gpdCall = PROTECT(Rf_lang2(Rf_install("getParseData"), srcfile));
+        SEXP parseData = PROTECT(Rf_eval(gpdCall, R_GlobalEnv));
+        std::vector<ParseNode *> frameRoots = generateAST(parseData, viaFrame);
+        double frameMs = millisecondsSince(start);
+
+        ParseArena viaRaw;
+        std::vector<ParseNode *> rawRoots;
+        start = std::chrono::steady_clock::now();
+        bool built = generateASTFromParseData(srcfile, viaRaw, rawRoots);
+        double rawMs = millisecondsSince(start);
+        UNPROTECT(3);
+
+        if (!built || canonicalAST(frameRoots) != canonicalAST(rawRoots))
+        {
+            std::cout << "Tree builders disagree at " << target << " tokens." << std::endl;
+            agree = false;
+        }
+
+        std::cout << std::left << std::setw(12) << target << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10) << parseMs << std::setw(15) << frameMs << std::setw(8)
+                  << rawMs << std::setw(9) << (rawMs > 0.0 ? frameMs / rawMs : 0.0) << "x" << std::endl;
+    }
+    return agree;
+}
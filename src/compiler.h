@@ -0,0 +1,96 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Rinternals.h>
+
+#undef length
+
+#include "parse.h"
+#include "arena.h"
+
+#ifndef STAR_VERSION
+#define STAR_VERSION "unknown"
+#endif
+
+enum class Frontend
+{
+    R,       // R_ParseVector + getParseData through the embedded session
+    Native,  // nativeParseSource(), no R session required
+    Compare, // parse with both and diff the trees (star parse only)
+};
+
+class CompileCache;
+class TimingReport;
+class ThreadPool;
+
+struct CompileOptions
+{
+    Frontend frontend = Frontend::R;
+    CompileCache *cache = nullptr; // optional, owned by the caller
+    TimingReport *timings = nullptr; // --timings: per-phase report, owned by the caller
+    ThreadPool *pool = nullptr;    // -j: compile files or streamed expressions in parallel
+    bool incremental = false;      // recompile changed top-level expressions only
+    bool streaming = false;        // compile files one top-level expression at a time
+
+    std::vector<std::string> disabledPasses; // --disable-pass
+    std::vector<std::string> enabledPasses;  // --enable-pass
+    bool passTimings = false;                // report per-pass wall time on stderr
+    bool runtimePrelude = true;              // start guarded output with the runtime prelude
+    bool memoChecks = false;                 // --memo-checks: skip checks on objects already validated
+    bool elideChecks = false;                // --elide-checks: drop checks every call site satisfies
+    bool nativeChecks = false;               // --native-checks: check through the native check library
+    bool profileChecks = false;              // --profile-checks: count and time every check at run time
+};
+
+bool parseFrontend(const std::string &name, Frontend &frontend);
+
+bool startsWith(const std::string &str, const char *prefix);
+
+// The "# @contract" lines declared in source, in order.
+std::vector<std::string> contractLines(const std::string &source);
+
+// Installs the contracts declared in source into TypeParser::functionContracts,
+// replacing any previously loaded ones.
+void loadContracts(const std::string &source);
+
+// Tree of a generated R snippet; throws std::runtime_error if it does not parse.
+std::vector<ParseNode *> generateASTFromSource(const std::string &code, Frontend frontend, ParseArena &arena);
+
+// Returns the root nodes of source, allocated in arena; name is used in
+// diagnostics.
+std::vector<ParseNode *> parseSource(const std::string &source, const char *name, Frontend frontend,
+                                     ParseArena &arena);
+
+// Returns the root nodes of filename, allocated in arena, or an empty vector if it failed to parse.
+std::vector<ParseNode *> parseFile(const char *filename, Frontend frontend, ParseArena &arena);
+
+// Runs the pass pipeline (see pipeline.h) over filename and writes the
+// result to outputPath, or copies the cached result when options.cache
+// already holds it. With options.streaming, the file is read, compiled and
+// written one top-level expression at a time instead (see stream.h). The
+// output path and, unless streaming, the output are echoed to echo. The R
+// front end requires an active RSession.
+// Returns false if the file could not be compiled.
+bool compileFile(const char *filename, const char *outputPath, const CompileOptions &options,
+                 std::ostream &echo = std::cout);
+
+// compileFile() for an in-memory buffer; the instrumented source is
+// returned in output. name is used in diagnostics.
+bool compileSource(const std::string &source, std::string &output, const CompileOptions &options,
+                   const char *name = "<source>");
+
+// Parses filename with both front ends, reports their timings and the first
+// node where the trees differ. Returns true if they agree.
+bool compareFrontends(const char *filename);
+
+// Times generateAST() on getParseData()'s data.frame against
+// generateASTFromParseData() on synthetic sources of 1k tokens up to
+// maxTokens, and checks that both build the same tree. Requires an
+// active RSession. Returns true if the trees always agree.
+bool benchTreeBuilders(size_t maxTokens);
+
+#endif
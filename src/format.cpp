@@ -0,0 +1,151 @@
+#include "format.h"
+
+static const size_t INDENT_WIDTH = 4;
+
+static bool isTerminal(const ParseNode* node) {
+    return node && node->children.empty() && !node->text.empty() && node->kind != TokenKind::Comment;
+}
+
+// Tokens after which an expression may be complete.
+static bool endsOperand(TokenKind kind) {
+    switch (kind) {
+    case TokenKind::Symbol: case TokenKind::NumConst: case TokenKind::StrConst:
+    case TokenKind::NullConst: case TokenKind::Slot: case TokenKind::RightParen:
+    case TokenKind::RightBracket: case TokenKind::RightBrace: case TokenKind::Break:
+    case TokenKind::Next:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isPrefixCapable(TokenKind kind) {
+    return kind == TokenKind::Minus || kind == TokenKind::Plus || kind == TokenKind::Bang ||
+           kind == TokenKind::Tilde || kind == TokenKind::Question;
+}
+
+static bool isTightOperator(TokenKind kind) {
+    return kind == TokenKind::Dollar || kind == TokenKind::At || kind == TokenKind::NsGet ||
+           kind == TokenKind::NsGetInt || kind == TokenKind::Colon || kind == TokenKind::Caret;
+}
+
+static bool isOpenBracket(TokenKind kind) {
+    return kind == TokenKind::LeftParen || kind == TokenKind::LeftBracket || kind == TokenKind::Lbb;
+}
+
+namespace {
+
+class Formatter {
+public:
+    std::string run(const std::vector<ParseNode*>& nodes);
+
+private:
+    std::string out;
+    std::string line;
+    size_t depth = 0;
+    TokenKind prev = TokenKind::Unknown;
+    bool prevUnary = false;
+
+    void flush() {
+        if (line.empty())
+            return;
+        out.append(depth * INDENT_WIDTH, ' ');
+        out += line;
+        out += '\n';
+        line.clear();
+    }
+
+    bool needsSpace(TokenKind token) const;
+    void emit(const ParseNode* node, const ParseNode* next);
+};
+
+bool Formatter::needsSpace(TokenKind token) const {
+    if (line.empty() || prevUnary)
+        return false;
+    if (token == TokenKind::RightParen || token == TokenKind::RightBracket || token == TokenKind::Comma)
+        return false;
+    if (isOpenBracket(prev))
+        return false;
+    if (prev == TokenKind::Comma)
+        return true;
+    if (isTightOperator(token) || isTightOperator(prev))
+        return false;
+    if (token == TokenKind::LeftBracket || token == TokenKind::Lbb)
+        return false;
+    if (token == TokenKind::LeftParen)
+        return !(endsOperand(prev) || prev == TokenKind::SymbolFunctionCall || prev == TokenKind::Function ||
+                 prev == TokenKind::Backslash);
+    return true;
+}
+
+void Formatter::emit(const ParseNode* node, const ParseNode* next) {
+    TokenKind token = node->kind;
+
+    // Where statements begin comes from the parse tree: a token stream alone
+    // cannot tell "a\n(b)" or "a\n-b" from a call or a subtraction.
+    if (node->startsStatement) {
+        flush();
+        prev = TokenKind::Unknown;
+    }
+
+    if (token == TokenKind::Semicolon) {
+        flush();
+        prev = token;
+        prevUnary = false;
+        return;
+    }
+
+    if (token == TokenKind::LeftBrace) {
+        flush();
+        line = node->text;
+        flush();
+        ++depth;
+        prev = token;
+        prevUnary = false;
+        return;
+    }
+
+    if (token == TokenKind::RightBrace) {
+        flush();
+        if (depth > 0)
+            --depth;
+        line = node->text;
+        prev = token;
+        prevUnary = false;
+
+        TokenKind nextToken = next ? next->kind : TokenKind::Unknown;
+        if (nextToken != TokenKind::Else && nextToken != TokenKind::RightParen && nextToken != TokenKind::Comma &&
+            nextToken != TokenKind::RightBracket)
+            flush();
+        return;
+    }
+
+    bool unary = isPrefixCapable(token) && !endsOperand(prev);
+    if (needsSpace(token))
+        line += ' ';
+    line += node->text;
+
+    prev = token;
+    prevUnary = unary;
+}
+
+std::string Formatter::run(const std::vector<ParseNode*>& nodes) {
+    std::vector<const ParseNode*> terminals;
+    terminals.reserve(nodes.size());
+    for (const ParseNode* node : nodes) {
+        if (isTerminal(node))
+            terminals.push_back(node);
+    }
+
+    for (size_t i = 0; i < terminals.size(); ++i)
+        emit(terminals[i], i + 1 < terminals.size() ? terminals[i + 1] : nullptr);
+    flush();
+    return out;
+}
+
+} // namespace
+
+std::string formatTokens(const std::vector<ParseNode*>& nodes) {
+    Formatter formatter;
+    return formatter.run(nodes);
+}
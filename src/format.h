@@ -0,0 +1,17 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <string>
+#include <vector>
+
+#include "parse.h"
+
+// Pretty prints a flattened token stream in one pass. Spacing comes from
+// the token kinds of each neighbouring pair, a new line starts at every
+// token flagged startsStatement (see terminalTokens()) and at every ';',
+// and indentation follows brace depth. Braces go on their own lines,
+// except that "}" keeps a following else, ")" or "," on the same line.
+// Non-terminal nodes and comments are skipped.
+std::string formatTokens(const std::vector<ParseNode*>& nodes);
+
+#endif
@@ -1,11 +1,11 @@
 #include <sstream>
 #include <unordered_map>
-#include <fstream>
-#include <regex>
 
 #include "parse.h"
 #include "gensource.h"
 #include "typelang.h"
+#include "pipeline.h"
+#include "checks.h"
 
 #undef length
 
@@ -19,11 +19,11 @@ std::vector<StatementRange> extractStatements(const std::vector<ParseNode*> node
     bool inStatement = false;
 
     for (size_t i = 0; i < nodes.size(); ++i) {
-        const std::string& tok = nodes[i]->text;
+        TokenKind tok = nodes[i]->kind;
 
         // Skip standalone comments
-        if (tok.rfind("#", 0) == 0) {
-            while (i + 1 < nodes.size() && nodes[i + 1]->text.rfind("#", 0) == 0)
+        if (tok == TokenKind::Comment) {
+            while (i + 1 < nodes.size() && nodes[i + 1]->kind == TokenKind::Comment)
                 ++i;
             continue;
         }
@@ -33,13 +33,14 @@ std::vector<StatementRange> extractStatements(const std::vector<ParseNode*> node
             inStatement = true;
         }
 
-        if (tok == "(") ++parenDepth;
-        else if (tok == ")") --parenDepth;
-        else if (tok == "{") ++braceDepth;
-        else if (tok == "}") --braceDepth;
+        if (tok == TokenKind::LeftParen) ++parenDepth;
+        else if (tok == TokenKind::RightParen) --parenDepth;
+        else if (tok == TokenKind::LeftBrace) ++braceDepth;
+        else if (tok == TokenKind::RightBrace) --braceDepth;
 
         if (inStatement && parenDepth == 0 && braceDepth == 0) {
-            if (tok == ")" || tok == "}" || i + 1 == nodes.size() || nodes[i + 1]->text.rfind("#", 0) == 0) {
+            if (tok == TokenKind::RightParen || tok == TokenKind::RightBrace || i + 1 == nodes.size() ||
+                nodes[i + 1]->kind == TokenKind::Comment) {
                 statements.push_back({stmtStart, i});
                 inStatement = false;
             }
@@ -69,240 +70,223 @@ std::vector<std::string> getStatementStrings(const std::vector<ParseNode*> nodes
     return result;
 }
 
-std::vector<std::string> preprocessLines(const std::vector<std::string>& lines) {
-    std::vector<std::string> processedLines;
-    for (const auto& line : lines) {
-        std::istringstream stream(line);
-        std::string statement;
-        while (std::getline(stream, statement, ';')) { // Split by semicolon
-            statement.erase(0, statement.find_first_not_of(" \t")); // Trim leading whitespace
-            statement.erase(statement.find_last_not_of(" \t") + 1); // Trim trailing whitespace
-            if (!statement.empty()) {
-                processedLines.push_back(statement); // Add the statement to the processed lines
-            }
-        }
-    }
-    return processedLines;
+static ParseNode* makeToken(CompilationUnit& unit, const char* token, const char* text) {
+    return unit.arena.makeNode(0, 0, token, text);
 }
 
-void injectInputTypeChecks(const char *outputPath) {
-    std::cout << "Injecting type checks into file: " << outputPath << std::endl;
-
-    std::ifstream file(outputPath);
-    if (!file.is_open()) {
-        std::cerr << "Error: Failed to open file: " << outputPath << std::endl;
-        return;
-    }
-
-    std::vector<std::string> lines;
-    std::string line;
-
-    while (std::getline(file, line)) {
-        lines.push_back(line);
+size_t matchingClose(const std::vector<ParseNode*>& tokens, size_t open) {
+    TokenKind opener = tokens[open]->kind;
+    TokenKind closer = opener == TokenKind::LeftBrace ? TokenKind::RightBrace : TokenKind::RightParen;
+    int depth = 0;
+    for (size_t i = open; i < tokens.size(); ++i) {
+        if (tokens[i]->kind == opener) ++depth;
+        else if (tokens[i]->kind == closer && --depth == 0) return i;
     }
-    file.close();
-
-    lines = preprocessLines(lines);
+    return tokens.size();
+}
 
-    std::ofstream outFile(outputPath);
-    if (!outFile.is_open()) {
-        std::cerr << "Error: Failed to open file for writing: " << outputPath << std::endl;
-        return;
+bool isFunctionDefinition(const std::vector<ParseNode*>& tokens, size_t i) {
+    if (i + 3 >= tokens.size() || tokens[i]->kind != TokenKind::Symbol)
+        return false;
+    if (i > 0) {
+        TokenKind before = tokens[i - 1]->kind;
+        if (before == TokenKind::Dollar || before == TokenKind::At || before == TokenKind::NsGet ||
+            before == TokenKind::NsGetInt)
+            return false;
     }
+    return (tokens[i + 1]->kind == TokenKind::LeftAssign || tokens[i + 1]->kind == TokenKind::EqAssign) &&
+           tokens[i + 2]->kind == TokenKind::Function && tokens[i + 3]->kind == TokenKind::LeftParen;
+}
 
-    for (size_t i = 0; i < lines.size(); ++i) {
-        std::smatch match;
-        if (std::regex_search(lines[i], match, std::regex("^(\\w+)\\s*<-\\s*function\\s*\\(([^)]*)\\)"))) {
-            std::string functionName = match[1];
-            std::string args = match[2];
-
-            auto it = TypeParser::functionContracts.find(functionName);
-            if (it != TypeParser::functionContracts.end()) {
-                const FunctionContract &contract = it->second;
-
-                // Write the function declaration line
-                outFile << lines[i] << "\n";
-
-                // Process the function arguments
-                while (i + 1 < lines.size() && lines[i + 1].find("{") == std::string::npos) {
-                    outFile << lines[++i] << "\n";
-                    args += lines[i];
-                }
-
-                // Write the opening brace
-                if (i + 1 < lines.size() && lines[i + 1].find("{") != std::string::npos) {
-                    outFile << lines[++i] << "\n";
-
-                    std::vector<std::string> argNames;
-                    std::istringstream argStream(args);
-                    std::string argName;
-                    while (std::getline(argStream, argName, ',')) {
-                        argName.erase(0, argName.find_first_not_of(" \t"));
-                        argName.erase(argName.find_last_not_of(" \t") + 1);
-                        argNames.push_back(argName);
-                    }
-
-                    for (size_t j = 0; j < contract.argTypes.size(); ++j) {
-                        if (j < argNames.size() && contract.argTypes[j]) {
-                            std::string argType = contract.argTypes[j]->toString();
-                            if (argType == "dataframe") {
-                                outFile << "stopifnot(is.data.frame(" << argNames[j] << "))\n";
-                            } else if (!argType.empty() && argType.size() > 2 && argType.substr(argType.size() - 2) == "[]") {
-                                std::string baseType = argType.substr(0, argType.size() - 2);
-                                outFile << "stopifnot(is.vector(" << argNames[j] << "))\n";
-                                outFile << "stopifnot(all(sapply(" << argNames[j] << ", is." << baseType << ")))\n";
-                            } else {
-                                outFile << "stopifnot(is." << argType << "(" << argNames[j] << "))\n";
-                            }
-                        }
-                    }
-                }
-            } else {
-                std::cerr << "Warning: No contract found for function: " << functionName << std::endl;
-                outFile << lines[i] << "\n";
-            }
-        } else {
-            outFile << lines[i] << "\n";
-        }
+std::vector<std::string_view> formalNames(const std::vector<ParseNode*>& tokens, size_t i) {
+    // Formals sit at depth one; deeper symbols belong to default values.
+    std::vector<std::string_view> names;
+    size_t close = matchingClose(tokens, i + 3);
+    int depth = 0;
+    for (size_t j = i + 3; j < close; ++j) {
+        if (tokens[j]->kind == TokenKind::LeftParen) ++depth;
+        else if (tokens[j]->kind == TokenKind::RightParen) --depth;
+        else if (depth == 1 && tokens[j]->kind == TokenKind::SymbolFormals) names.push_back(tokens[j]->text);
     }
+    return names;
+}
 
-    outFile.close();
-    std::cout << "Type checks successfully injected into file: " << outputPath << std::endl;
+// Index of the '{' opening the body of the function defined at tokens[i],
+// or 0 if the body is not braced.
+static size_t bracedBody(const std::vector<ParseNode*>& tokens, size_t i) {
+    size_t close = matchingClose(tokens, i + 3);
+    if (close + 1 >= tokens.size() || tokens[close + 1]->kind != TokenKind::LeftBrace)
+        return 0;
+    return close + 1;
 }
 
-std::string extractReturnExpression(const std::vector<std::string>& lines, size_t returnLineIndex) {
-    std::cerr << "Extracting return expression from line " << returnLineIndex << ": " << lines[returnLineIndex] << std::endl;
+void injectInputTypeChecks(CompilationUnit& unit, bool guarded, bool memoize, bool native, bool profile) {
+    const std::vector<ParseNode*>& tokens = unit.tokens;
 
-    size_t returnPos = lines[returnLineIndex].find("return");
-    if (returnPos != std::string::npos) {
-        size_t exprStart = returnPos + 6; // Length of "return"
-        while (exprStart < lines[returnLineIndex].size() && std::isspace(lines[returnLineIndex][exprStart])) {
-            ++exprStart;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (!isFunctionDefinition(tokens, i))
+            continue;
+
+        std::string functionName(tokens[i]->text);
+        auto it = TypeParser::functionContracts.find(functionName);
+        if (it == TypeParser::functionContracts.end()) {
+            std::cerr << "Warning: No contract found for function: " << functionName << std::endl;
+            continue;
         }
+        const FunctionContract& contract = it->second;
 
-        // Start building the return expression
-        std::string returnExpression = lines[returnLineIndex].substr(exprStart);
+        size_t body = bracedBody(tokens, i);
+        if (!body) {
+            std::cerr << "Warning: Function " << functionName << " has no braced body; input checks skipped" << std::endl;
+            continue;
+        }
 
-        // Check if the expression spans multiple lines
-        size_t currentLine = returnLineIndex + 1;
-        while (currentLine < lines.size() && lines[currentLine].find("}") == std::string::npos) {
-            returnExpression += " " + lines[currentLine];
-            ++currentLine;
+        std::vector<std::string_view> argNames = formalNames(tokens, i);
+
+        auto provenIt = unit.provenArguments.find(functionName);
+        const std::vector<bool>* proven = provenIt == unit.provenArguments.end() ? nullptr : &provenIt->second;
+
+        std::vector<ParseNode*> inserted;
+        size_t checks = 0;
+        for (size_t k = 0; k < contract.argTypes.size() && k < argNames.size(); ++k) {
+            if (!contract.argTypes[k] || (proven && k < proven->size() && (*proven)[k]))
+                continue;
+            std::vector<ParseNode*> check = argumentCheckTokens(contract.argTypes[k], argNames[k], memoize, native,
+                                                                profile ? functionName : "", unit.arena);
+            inserted.insert(inserted.end(), check.begin(), check.end());
+            inserted.push_back(makeToken(unit, "';'", ";"));
+            ++checks;
         }
+        if (inserted.empty())
+            continue;
 
-        // Trim any trailing whitespace
-        returnExpression.erase(returnExpression.find_last_not_of(" \t\n\r") + 1);
+        if (guarded) {
+            inserted = guardedTokens(guardVariable(unit.arena), inserted, checks > 1, unit.arena);
+            inserted.push_back(makeToken(unit, "';'", ";"));
+        }
+        unit.edits.insert(body + 1, std::move(inserted));
+    }
+}
 
-        // Ensure balanced parentheses and braces
-        size_t openParenCount = std::count(returnExpression.begin(), returnExpression.end(), '(');
-        size_t closeParenCount = std::count(returnExpression.begin(), returnExpression.end(), ')');
-        size_t openBraceCount = std::count(returnExpression.begin(), returnExpression.end(), '{');
-        size_t closeBraceCount = std::count(returnExpression.begin(), returnExpression.end(), '}');
+namespace {
 
-        while (closeParenCount < openParenCount) {
-            returnExpression += ")";
-            ++closeParenCount;
-        }
-        while (closeBraceCount < openBraceCount) {
-            returnExpression += "}";
-            ++closeBraceCount;
+// Pairs every return() call with the innermost function it belongs to.
+struct ReturnCollector {
+    const SyntaxTree& tree;
+    std::vector<int> functions;
+    std::vector<std::pair<int, int>> returns; // (return symbol row, function row)
+
+    explicit ReturnCollector(const SyntaxTree& tree) : tree(tree) {}
+
+    bool enter(int row, int) {
+        if (tree.leadingKind(row) == TokenKind::Function) {
+            functions.push_back(row);
+        } else if (!functions.empty() && tree.kind(row) == TokenKind::SymbolFunctionCall &&
+                   tree.text(row) == "return") {
+            returns.push_back({row, functions.back()});
         }
+        return true;
+    }
 
-        std::cerr << "Extracted return expression: " << returnExpression << std::endl;
-        return returnExpression;
+    void leave(int row, int) {
+        if (tree.leadingKind(row) == TokenKind::Function)
+            functions.pop_back();
     }
+};
 
-    std::cerr << "No return expression found on line: " << returnLineIndex << std::endl;
-    return "";
-}
+} // namespace
 
-void generateOutputTypeChecks(const char *outputPath) {
-    std::cout << "Generating output type checks for file: " << outputPath << std::endl;
+void generateOutputTypeChecks(CompilationUnit& unit, bool guarded, bool native, bool profile) {
+    const std::vector<ParseNode*>& tokens = unit.tokens;
+    const SyntaxTree& tree = unit.tree;
 
-    std::ifstream file(outputPath);
-    if (!file.is_open()) {
-        std::cerr << "Error: Failed to open file: " << outputPath << std::endl;
-        return;
+    std::vector<int> tokenIndex(tree.size(), -1);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        int row = tree.row(tokens[i]->id);
+        if (row >= 0)
+            tokenIndex[row] = static_cast<int>(i);
     }
 
-    std::vector<std::string> lines;
-    std::string line;
-
-    while (std::getline(file, line)) {
-        lines.push_back(line);
+    struct ReturnContract {
+        const Type* type;
+        std::string_view name;
+        bool braced; // has the .star_checking guard, see insertEnforcementGuards()
+    };
+    std::unordered_map<int, ReturnContract> returnTypes;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (!isFunctionDefinition(tokens, i))
+            continue;
+        auto it = TypeParser::functionContracts.find(std::string(tokens[i]->text));
+        if (it == TypeParser::functionContracts.end() || !it->second.returnType)
+            continue;
+        int keyword = tree.row(tokens[i + 2]->id);
+        if (keyword >= 0)
+            returnTypes[tree.parent(keyword)] = {it->second.returnType, tokens[i]->text, bracedBody(tokens, i) != 0};
     }
-    file.close();
+    if (returnTypes.empty())
+        return;
 
-    lines = preprocessLines(lines);
+    ReturnCollector collector(tree);
+    tree.walk(collector);
 
-    std::ofstream outFile(outputPath, std::ios::out);
-    if (!outFile.is_open()) {
-        std::cerr << "Error: Failed to open file for writing: " << outputPath << std::endl;
-        return;
+    size_t done = 0;
+    for (auto [row, function] : collector.returns) {
+        auto typeIt = returnTypes.find(function);
+        if (typeIt == returnTypes.end() || tokenIndex[row] < 0)
+            continue;
+
+        size_t i = tokenIndex[row];
+        if (i < done || i + 1 >= tokens.size() || tokens[i + 1]->kind != TokenKind::LeftParen)
+            continue;
+        size_t close = matchingClose(tokens, i + 1);
+        if (close >= tokens.size() || close == i + 2)
+            continue;
+
+        // return(EXPR) becomes a block that evaluates EXPR once, checks it
+        // and returns it. The braces are only needed outside of a block.
+        int call = tree.parent(tree.parent(row));
+        int container = call >= 0 ? tree.parent(call) : -1;
+        bool inBlock = container >= 0 && tree.leadingKind(container) == TokenKind::LeftBrace;
+
+        std::vector<ParseNode*> replacement;
+        if (!inBlock)
+            replacement.push_back(makeToken(unit, "'{'", "{"));
+        replacement.push_back(makeToken(unit, "SYMBOL", "outputTypecheckExpression"));
+        replacement.push_back(makeToken(unit, "LEFT_ASSIGN", "<-"));
+        replacement.insert(replacement.end(), tokens.begin() + i + 1, tokens.begin() + close + 1);
+        replacement.push_back(makeToken(unit, "';'", ";"));
+        // A function without a braced body has no guard variable, but it
+        // also evaluates at most one return() per call.
+        const ReturnContract& contract = typeIt->second;
+        std::vector<ParseNode*> condition;
+        if (guarded)
+            condition = contract.braced ? guardVariable(unit.arena) : enforcementCondition(contract.name, unit.arena);
+        std::vector<ParseNode*> check = returnCheckTokens(contract.type, condition, native,
+                                                          profile ? contract.name : "", unit.arena);
+        replacement.insert(replacement.end(), check.begin(), check.end());
+        if (!inBlock)
+            replacement.push_back(makeToken(unit, "'}'", "}"));
+        replacement.front()->startsStatement = tokens[i]->startsStatement;
+
+        unit.edits.replace(i, close + 1, std::move(replacement));
+        done = close + 1;
     }
+}
 
-    for (size_t i = 0; i < lines.size(); ++i) {
-        std::smatch match;
-        if (std::regex_search(lines[i], match, std::regex("^(\\w+)\\s*<-\\s*function\\s*\\(([^)]*)\\)"))) {
-            std::string functionName = match[1];
-
-            outFile << lines[i] << "\n";
-
-            auto it = TypeParser::functionContracts.find(functionName);
-            if (it != TypeParser::functionContracts.end()) {
-                const FunctionContract &contract = it->second;
-
-                size_t j = i + 1;
-                bool returnFound = false;
-
-                while (j < lines.size() && lines[j].find("{") == std::string::npos) {
-                    outFile << lines[j] << "\n";
-                    ++j;
-                }
-
-                if (j < lines.size() && lines[j].find("{") != std::string::npos) {
-                    outFile << lines[j] << "\n";
-                    ++j;
-                }
-
-                while (j < lines.size()) {
-                    if (lines[j].find("return") != std::string::npos) {
-                        returnFound = true;
-                        std::string returnExpression = extractReturnExpression(lines, j);
-                        std::string returnType = contract.returnType->toString();
-
-                        // Ensure balanced parentheses in the return expression
-                        returnExpression = returnExpression;
-
-                        if (returnType == "dataframe") {
-                            outFile << "outputTypecheckExpression <- " << returnExpression << "\n";
-                            outFile << "if (!is.data.frame(outputTypecheckExpression)) stop('Output must be a data frame')\n";
-                        } else if (returnType.size() > 2 && returnType.substr(returnType.size() - 2) == "[]") {
-                            std::string baseType = returnType.substr(0, returnType.size() - 2);
-                            outFile << "outputTypecheckExpression <- " << returnExpression << "\n";
-                            outFile << "if (!is.list(outputTypecheckExpression)) stop('Output must be a list')\n";
-                            outFile << "if (!all(sapply(outputTypecheckExpression, is." << baseType << "))) stop('All elements in the output list must be of type " << baseType << "')\n";
-                        } else {
-                            outFile << "outputTypecheckExpression <- " << returnExpression << "\n";
-                            outFile << "if (!is." << returnType << "(outputTypecheckExpression)) stop('Output must be of type " << returnType << "')\n";
-                        }
-
-                        outFile << "return(outputTypecheckExpression)\n";
-                        ++j;
-                        continue;
-                    }
-
-                    outFile << lines[j] << "\n";
-                    ++j;
-                }
-
-                i = j - 1;
-            }
-        } else {
-            outFile << lines[i] << "\n";
-        }
+void insertEnforcementGuards(CompilationUnit& unit, bool prelude, bool native, bool memoize, bool profile) {
+    const std::vector<ParseNode*>& tokens = unit.tokens;
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (!isFunctionDefinition(tokens, i) || !TypeParser::functionContracts.count(std::string(tokens[i]->text)))
+            continue;
+        size_t body = bracedBody(tokens, i);
+        if (!body)
+            continue;
+        std::vector<ParseNode*> guard = guardTokens(tokens[i]->text, unit.arena);
+        guard.push_back(makeToken(unit, "';'", ";"));
+        unit.edits.insert(body + 1, std::move(guard));
     }
 
-    outFile.close();
-    std::cout << "Output type checks successfully generated for file: " << outputPath << std::endl;
-}
\ No newline at end of file
+    if (prelude && !TypeParser::functionContracts.empty())
+        unit.edits.insert(0, runtimePreludeTokens(native, memoize, profile, unit.arena));
+}
@@ -13,6 +13,10 @@
 
 #undef length
 
+#include "compiler.h"
+
+struct CompilationUnit;
+
 struct StatementRange {
     size_t start;
     size_t end;
@@ -22,9 +26,36 @@ std::vector<StatementRange> extractStatements(const std::vector<ParseNode*> node
 
 std::vector<std::string> getStatementStrings(const std::vector<ParseNode*> nodes, std::vector<StatementRange> ranges);
 
-std::string generateTypeCheck(const std::string& argName, const std::string& typeName);
-
-void injectInputTypeChecks(const char *outputPath);
-void generateOutputTypeChecks(const char *outputPath);
+// Index of the token that closes the bracket opened at tokens[open], or
+// tokens.size() if it is unbalanced.
+size_t matchingClose(const std::vector<ParseNode*>& tokens, size_t open);
+
+// A function definition "name <- function(" starting at tokens[i]. Member
+// and namespace targets (x$f <- function ...) are not plain definitions.
+bool isFunctionDefinition(const std::vector<ParseNode*>& tokens, size_t i);
+
+// Formal argument names of the function defined at tokens[i].
+std::vector<std::string_view> formalNames(const std::vector<ParseNode*>& tokens, size_t i);
+
+// Inserts argumentCheckTokens() statements at the top of every contracted
+// function body, as insertions in unit.edits. When guarded, they only run
+// if .star_checking is set (see insertEnforcementGuards()); memoize skips
+// them for objects the runtime cache has already seen pass. native checks
+// through the native check library where it covers the type; profile
+// wraps every check in the check profiler.
+void injectInputTypeChecks(CompilationUnit& unit, bool guarded, bool memoize, bool native, bool profile);
+
+// Rewrites each return(EXPR) of a contracted function so that EXPR is
+// checked against the function's declared return type before it is returned.
+// The rewrites are recorded in unit.edits. When guarded, the check runs
+// under the function's enforcement level. native and profile as above.
+void generateOutputTypeChecks(CompilationUnit& unit, bool guarded, bool native, bool profile);
+
+// Starts every braced contracted function body with the .star_checking
+// guard the checks above read, and the file with runtimePreludeTokens() if
+// prelude is set and the file declares contracts; native, memoize and
+// profile add the native library binding, the memo cache and the check
+// profiler to the prelude.
+void insertEnforcementGuards(CompilationUnit& unit, bool prelude, bool native, bool memoize, bool profile);
 
 #endif
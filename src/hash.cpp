@@ -0,0 +1,103 @@
+#include <cstring>
+
+#include "hash.h"
+
+static const uint64_t K1 = 0x87c37b91114253d5ULL;
+static const uint64_t K2 = 0x4cf5ad432745937fULL;
+
+static uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+std::string Hash128::hex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        out[15 - i] = digits[(hi >> (i * 4)) & 0xf];
+        out[31 - i] = digits[(lo >> (i * 4)) & 0xf];
+    }
+    return out;
+}
+
+Hasher::Hasher() : lanes{0x9e3779b97f4a7c15ULL, 0x632be59bd9b4e019ULL}, total(0), tailSize(0) {}
+
+void Hasher::mixWord(uint64_t word) {
+    uint64_t k = rotl(word * K1, 31) * K2;
+    lanes[0] = rotl(lanes[0] ^ k, 27) * 5 + 0x52dce729;
+    lanes[1] = rotl(lanes[1] ^ (k + lanes[0]), 31) * 5 + 0x38495ab5;
+}
+
+Hasher& Hasher::update(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    total += size;
+
+    while (size > 0 && tailSize > 0) {
+        tail[tailSize++] = *p++;
+        --size;
+        if (tailSize == 8) {
+            uint64_t word;
+            std::memcpy(&word, tail, 8);
+            mixWord(word);
+            tailSize = 0;
+        }
+    }
+
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        mixWord(word);
+        p += 8;
+        size -= 8;
+    }
+
+    std::memcpy(tail + tailSize, p, size);
+    tailSize += size;
+    return *this;
+}
+
+Hasher& Hasher::update(const std::string& s) {
+    update(static_cast<uint64_t>(s.size()));
+    return update(s.data(), s.size());
+}
+
+Hasher& Hasher::update(uint64_t value) {
+    return update(&value, sizeof(value));
+}
+
+Hash128 Hasher::digest() const {
+    uint64_t a = lanes[0];
+    uint64_t b = lanes[1];
+
+    uint64_t word = 0;
+    std::memcpy(&word, tail, tailSize);
+    uint64_t k = rotl(word * K1, 31) * K2;
+    a ^= k ^ total;
+    b ^= rotl(k, 17) ^ total;
+
+    a += b;
+    b += a;
+    a = fmix(a);
+    b = fmix(b);
+    a += b;
+    b += a;
+
+    Hash128 h;
+    h.lo = a;
+    h.hi = b;
+    return h;
+}
+
+Hash128 hashBytes(const std::string& s) {
+    Hasher hasher;
+    hasher.update(s.data(), s.size());
+    return hasher.digest();
+}
@@ -0,0 +1,40 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct Hash128 {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    std::string hex() const;
+    bool operator==(const Hash128& other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
+// Streaming 128-bit content hash (two independently seeded 64-bit lanes).
+// Not cryptographic; used to address cache entries and fingerprint sources.
+class Hasher {
+public:
+    Hasher();
+
+    Hasher& update(const void* data, size_t size);
+    Hasher& update(const std::string& s);
+    Hasher& update(uint64_t value);
+
+    Hash128 digest() const;
+
+private:
+    uint64_t lanes[2];
+    uint64_t total;
+    unsigned char tail[8];
+    size_t tailSize;
+
+    void mixWord(uint64_t word);
+};
+
+Hash128 hashBytes(const std::string& s);
+
+#endif
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "incremental.h"
+#include "cache.h"
+#include "checks.h"
+#include "format.h"
+#include "hash.h"
+#include "nativeparse.h"
+#include "pipeline.h"
+
+// Maps each contracted function name to its "# @contract" line. Later
+// declarations win, matching TypeParser::addFunctionContract().
+static std::unordered_map<std::string, std::string> contractsByName(const std::string& source) {
+    std::unordered_map<std::string, std::string> contracts;
+    for (const std::string& line : contractLines(source)) {
+        std::istringstream iss(line.substr(11));
+        std::string name;
+        if (iss >> name)
+            contracts[name] = line;
+    }
+    return contracts;
+}
+
+bool compileIncremental(const std::string& source, std::string& output, const CompileOptions& options,
+                        IncrementalReport& report) {
+    if (!options.cache)
+        throw std::runtime_error("Incremental compilation requires a compile cache.");
+
+    std::vector<SourceChunk> chunks = splitTopLevel(source);
+    std::unordered_map<std::string, std::string> contracts = contractsByName(source);
+
+    // Fragments are compiled on their own; they must not recurse into the
+    // incremental path or be stored a second time as whole files.
+    CompileOptions fragmentOptions = options;
+    fragmentOptions.cache = nullptr;
+    fragmentOptions.incremental = false;
+    // The runtime prelude is emitted once, ahead of every fragment.
+    fragmentOptions.runtimePrelude = false;
+
+    output.clear();
+    if (!contracts.empty() && runtimeEnabled(options)) {
+        ParseArena arena;
+        output = formatTokens(runtimePreludeTokens(options.nativeChecks, options.memoChecks, options.profileChecks, arena));
+    }
+    for (const SourceChunk& chunk : chunks) {
+        std::string text = source.substr(chunk.begin, chunk.end - chunk.begin);
+        std::string contract;
+        if (!chunk.definedName.empty()) {
+            auto it = contracts.find(chunk.definedName);
+            if (it != contracts.end())
+                contract = it->second;
+        }
+
+        Hasher hasher;
+        hasher.update(std::string("fragment"));
+        hasher.update(std::string(STAR_VERSION));
+        hasher.update(optionsFingerprint(options));
+        hasher.update(contract);
+        hasher.update(text);
+        std::string key = hasher.digest().hex();
+
+        ++report.fragments;
+        std::string compiled;
+        if (!options.cache->lookup(key, compiled)) {
+            // The contract may be declared anywhere in the file; give the
+            // fragment its own copy so it compiles the same in isolation.
+            std::string fragmentSource = contract.empty() ? text : contract + "\n" + text;
+            if (!compileSource(fragmentSource, compiled, fragmentOptions))
+                return false;
+            options.cache->insert(key, compiled);
+            ++report.recompiled;
+        }
+        output += compiled;
+    }
+
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <string>
+
+#include "compiler.h"
+
+struct IncrementalReport {
+    size_t fragments = 0;
+    size_t recompiled = 0;
+};
+
+// Compiles source one top-level expression at a time. Each expression is
+// fingerprinted together with the contract of the function it defines;
+// fragments whose fingerprint is already in options.cache are reused and
+// only the rest go through the pipeline. Requires options.cache.
+bool compileIncremental(const std::string& source, std::string& output, const CompileOptions& options,
+                        IncrementalReport& report);
+
+#endif
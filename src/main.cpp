@@ -1,259 +1,527 @@
 // main.cpp
-#include <fstream>
-#include <sstream>
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
-#include <fcntl.h>
-#include <cerrno>
-#include <unistd.h>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
 #include <sys/stat.h>
-#include <algorithm>
-#include <cctype>
-#include <regex>
+#include <sys/resource.h>
+
+#include "rsession.h"
+#include "compiler.h"
+#include "build.h"
+#include "nativeparse.h"
+#include "server.h"
+#include "cache.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "timings.h"
 
-#include <R.h>
-#include <R_ext/Rdynload.h>
-#include <Rinternals.h>
-#include <Rembedded.h>
-#include <R_ext/Parse.h>
+bool fileExists(const char *path)
+{
+    struct stat buffer;
+    return stat(path, &buffer) == 0;
+}
 
-#undef length
+static void printUsage(const char *argv0)
+{
+    std::cerr << "Usage: " << argv0 << " run <filename> -o <output path> [options]" << std::endl;
+    std::cerr << "       " << argv0 << " build <directory|manifest> -o <output directory> [options]" << std::endl;
+    std::cerr << "       " << argv0 << " parse <filename> [--frontend=r|native|compare] [--stats]" << std::endl;
+    std::cerr << "       " << argv0 << " serve --socket <path> [options]" << std::endl;
+    std::cerr << "       " << argv0 << " status|stop --socket <path>" << std::endl;
+    std::cerr << "       " << argv0 << " cache stats|clear [--cache-dir=<dir>]" << std::endl;
+    std::cerr << "       " << argv0 << " passes" << std::endl;
+    std::cerr << "       " << argv0 << " bench-builders [--max-tokens=<n>]" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --frontend=r|native   parser used to build the AST (default: r)" << std::endl;
+    std::cerr << "  --socket <path>       compile through a 'star serve' daemon (default: $STAR_SOCKET)" << std::endl;
+    std::cerr << "  --cache               reuse outputs from the compile cache" << std::endl;
+    std::cerr << "  --cache-dir=<dir>     cache location (implies --cache, default: " << CompileCache::defaultDirectory() << ")" << std::endl;
+    std::cerr << "  --incremental         recompile only the top-level expressions that changed (implies --cache)" << std::endl;
+    std::cerr << "  --stream              compile and write one top-level expression at a time, in bounded memory" << std::endl;
+    std::cerr << "  -j <n>                compile files (build) or streamed expressions (run --stream) on n threads" << std::endl;
+    std::cerr << "  --cache-size=<MB>     evict least recently used entries above this size (default: 512)" << std::endl;
+    std::cerr << "  --disable-pass=<a,b>  skip the named passes (see 'passes')" << std::endl;
+    std::cerr << "  --enable-pass=<a,b>   run passes that are off by default" << std::endl;
+    std::cerr << "  --pass-timings        report the wall time of each pass on stderr" << std::endl;
+    std::cerr << "  --timings[=json]      report wall and CPU time per phase, sizes and peak RSS on stderr" << std::endl;
+    std::cerr << "  --memo-checks         skip argument checks on objects that already passed them" << std::endl;
+    std::cerr << "  --elide-checks        omit argument checks that every call site in the file satisfies" << std::endl;
+    std::cerr << "  --native-checks       run checks in the native check library through .Call()" << std::endl;
+    std::cerr << "  --profile-checks      count and time every check at run time; summary written at exit" << std::endl;
+    std::cerr << "  --stats               with 'parse': report node count, arena use and peak RSS instead of the tree" << std::endl;
+}
 
-#include "parse.h"
-#include "typelang.h"
-#include "gensource.h"
+static int listPasses()
+{
+    for (const PassInfo &pass : registeredPasses())
+    {
+        std::cout << std::left << std::setw(16) << pass.name << pass.description;
+        if (pass.required)
+            std::cout << " (required)";
+        else if (!pass.enabledByDefault)
+            std::cout << " (off by default)";
+        std::cout << std::endl;
+    }
+    return 0;
+}
 
-bool startsWith(const std::string &str, const char *prefix)
+// Splits a comma separated --enable-pass/--disable-pass value into names.
+static bool parsePassList(const std::string &list, bool disabling, std::vector<std::string> &names)
 {
-    size_t lenPrefix = std::strlen(prefix);
-    return str.size() >= lenPrefix && std::strncmp(str.c_str(), prefix, lenPrefix) == 0;
+    std::istringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ','))
+    {
+        if (!isKnownPass(name))
+        {
+            std::cerr << "Unknown pass: " << name << std::endl;
+            return false;
+        }
+        for (const PassInfo &pass : registeredPasses())
+        {
+            if (disabling && pass.required && name == pass.name)
+            {
+                std::cerr << "Pass '" << name << "' is required and cannot be disabled." << std::endl;
+                return false;
+            }
+        }
+        names.push_back(name);
+    }
+    return true;
 }
 
-SEXP tokenizeRString(const char *code)
+static int cacheCommand(const std::string &action, const std::string &directory)
 {
-    SEXP expr = PROTECT(Rf_mkString(code));
-    ParseStatus parseStatus;
-    SEXP parsed = PROTECT(R_ParseVector(expr, -1, &parseStatus, R_NilValue));
-    if (parseStatus != PARSE_OK)
+    CompileCache cache(directory, 0);
+    if (action == "clear")
+    {
+        cache.clear();
+        std::cout << "Cleared " << directory << std::endl;
+        return 0;
+    }
+    if (action != "stats")
     {
-        UNPROTECT(2);
-        throw std::runtime_error("Failed to parse the provided R code.");
+        std::cerr << "Unknown cache command: " << action << std::endl;
+        return 1;
     }
-    UNPROTECT(2);
-    return parsed;
+
+    CacheStats stats = cache.totals();
+    uint64_t lookups = stats.hits + stats.misses;
+    std::cout << "directory:   " << directory << std::endl;
+    std::cout << "size:        " << cache.size() << " bytes" << std::endl;
+    std::cout << "hits:        " << stats.hits << std::endl;
+    std::cout << "misses:      " << stats.misses << std::endl;
+    std::cout << "hit rate:    " << (lookups ? 100.0 * stats.hits / lookups : 0.0) << "%" << std::endl;
+    std::cout << "bytes saved: " << stats.bytesSaved << std::endl;
+    std::cout << "evictions:   " << stats.evictions << std::endl;
+    return 0;
 }
 
-std::vector<ParseNode *> generateASTFromSource(const std::string &code)
+// 'parse --stats': memory cost of the tree for filename.
+static int parseStats(const char *filename, Frontend frontend)
 {
-    SEXP tokens = tokenizeRString(code.c_str());
-    return generateAST(tokens);
+    ParseArena arena;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ParseNode *> roots = parseFile(filename, frontend, arena);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (roots.empty())
+        return 1;
+
+    ArenaStats stats = arena.stats();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << "nodes:            " << stats.nodes << std::endl;
+    std::cout << "interned strings: " << stats.strings << std::endl;
+    std::cout << "arena reserved:   " << stats.bytes << " (" << (stats.nodes ? stats.bytes / stats.nodes : 0)
+              << " per node)" << std::endl;
+    std::cout << "heap allocations: " << stats.allocations << " ("
+              << (stats.nodes ? static_cast<double>(stats.allocations) / stats.nodes : 0.0) << " per node)" << std::endl;
+    std::cout << "peak RSS:         " << usage.ru_maxrss << " KB" << std::endl;
+    std::cout << "parse time:       " << ms << " ms" << std::endl;
+    return 0;
 }
 
-void run(const char *filename, const char *outputPath)
+// Thin client for 'run': ship the file to the daemon and write its reply.
+static int runRemote(const std::string &socketPath, const char *filename, const std::string &outputPath,
+                     const CompileOptions &options)
 {
-    SEXP tokens = tokenizeRSource(filename);
-    if (!Rf_inherits(tokens, "data.frame"))
+    std::ifstream in(filename, std::ios::binary);
+    std::ostringstream source;
+    source << in.rdbuf();
+
+    std::string output;
+    if (!remoteCompile(socketPath, source.str(), output, options))
     {
-        std::cerr << "Error: tokenization did not return a data.frame." << std::endl;
-        return;
+        std::cerr << "Error: " << output << std::endl;
+        return 1;
     }
 
-    std::vector<ParseNode *> rootNodes = generateAST(tokens);
-    std::vector<ParseNode *> flatAST = flattenAST(rootNodes);
+    std::ofstream out(outputPath, std::ios::binary);
+    out << output;
+    return out ? 0 : 1;
+}
 
-    // Load contracts
-    TypeParser::functionContracts.clear();
-    std::ifstream file(filename);
-    std::string line;
-    while (std::getline(file, line))
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
     {
-        if (!startsWith(line, "# @contract"))
-            continue;
-        std::string contractLine = line.substr(11);
-        contractLine.erase(0, contractLine.find_first_not_of(" \t"));
-
-        std::istringstream iss(contractLine);
-        std::string functionName;
-        iss >> functionName;
-        std::string typeExpr;
-        std::getline(iss, typeExpr);
-        typeExpr.erase(0, typeExpr.find_first_not_of(" \t"));
+        printUsage(argv[0]);
+        return 1;
+    }
 
-        try
+    std::string command = argv[1];
+    std::vector<std::string> positional;
+    std::string outputPath;
+    std::string socketPath;
+    std::string cacheDir;
+    bool useCache = false;
+    bool showStats = false;
+    size_t maxTokens = 1000000;
+    uint64_t cacheMegabytes = 512;
+    std::unique_ptr<TimingReport> timings;
+    unsigned jobs = 1;
+    CompileOptions options;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
         {
-            TypeParser parser(typeExpr);
-            if (auto *funcType = dynamic_cast<FunctionType *>(parser.parseType()))
+            outputPath = argv[++i];
+        }
+        else if (startsWith(arg, "-j") && (arg.size() > 2 || i + 1 < argc))
+        {
+            std::string value = arg.size() > 2 ? arg.substr(2) : argv[++i];
+            char *end = nullptr;
+            unsigned long n = std::strtoul(value.c_str(), &end, 10);
+            if (value.empty() || *end || n == 0 || n > 1024)
             {
-                TypeParser::addFunctionContract(functionName, {.argTypes = funcType->arguments,
-                                                               .returnType = funcType->returnType});
+                std::cerr << "Invalid number of jobs: " << value << std::endl;
+                return 1;
             }
+            jobs = static_cast<unsigned>(n);
         }
-        catch (const std::exception &e)
+        else if (arg == "--socket" && i + 1 < argc)
         {
-            std::cerr << "Contract parse error: " << e.what() << std::endl;
+            socketPath = argv[++i];
+        }
+        else if (startsWith(arg, "--frontend="))
+        {
+            if (!parseFrontend(arg.substr(11), options.frontend))
+            {
+                std::cerr << "Unknown front end: " << arg.substr(11) << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--cache")
+        {
+            useCache = true;
+        }
+        else if (arg == "--incremental")
+        {
+            useCache = true;
+            options.incremental = true;
+        }
+        else if (arg == "--stream")
+        {
+            options.streaming = true;
+        }
+        else if (startsWith(arg, "--cache-dir="))
+        {
+            useCache = true;
+            cacheDir = arg.substr(12);
+        }
+        else if (startsWith(arg, "--cache-size="))
+        {
+            cacheMegabytes = std::strtoull(arg.c_str() + 13, nullptr, 10);
+        }
+        else if (startsWith(arg, "--disable-pass="))
+        {
+            if (!parsePassList(arg.substr(15), true, options.disabledPasses))
+                return 1;
+        }
+        else if (startsWith(arg, "--enable-pass="))
+        {
+            if (!parsePassList(arg.substr(14), false, options.enabledPasses))
+                return 1;
+        }
+        else if (arg == "--pass-timings")
+        {
+            options.passTimings = true;
+        }
+        else if (arg == "--timings" || arg == "--timings=text")
+        {
+            timings = std::make_unique<TimingReport>(TimingReport::Format::Text);
+        }
+        else if (arg == "--timings=json")
+        {
+            timings = std::make_unique<TimingReport>(TimingReport::Format::Json);
+        }
+        else if (arg == "--memo-checks")
+        {
+            options.memoChecks = true;
+        }
+        else if (arg == "--elide-checks")
+        {
+            options.elideChecks = true;
+        }
+        else if (arg == "--native-checks")
+        {
+            options.nativeChecks = true;
+        }
+        else if (arg == "--profile-checks")
+        {
+            options.profileChecks = true;
+        }
+        else if (arg == "--stats")
+        {
+            showStats = true;
+        }
+        else if (startsWith(arg, "--max-tokens="))
+        {
+            maxTokens = std::strtoull(arg.c_str() + 13, nullptr, 10);
+        }
+        else if (startsWith(arg, "-") && arg != "-")
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+        else
+        {
+            positional.push_back(arg);
         }
     }
 
-    // Inject type checks for functions with contracts
-    for (size_t i = 0; i + 4 < flatAST.size(); ++i)
-    {
-        if (!flatAST[i])
-            continue;
+    if (command == "passes")
+        return listPasses();
 
-        if (flatAST[i + 1]->text == "<-" &&
-            flatAST[i + 2]->text == "function" &&
-            flatAST[i + 3]->text == "(")
+    if (command == "bench-builders")
+    {
+        try
         {
+            RSession session;
+            return benchTreeBuilders(maxTokens) ? 0 : 1;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-            std::string funcName = flatAST[i]->text;
-            auto it = TypeParser::functionContracts.find(funcName);
-            if (it == TypeParser::functionContracts.end())
-                continue;
+    if (cacheDir.empty())
+        cacheDir = CompileCache::defaultDirectory();
 
-            const auto &contract = it->second;
+    if (command == "cache")
+    {
+        if (positional.size() != 1)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        try
+        {
+            return cacheCommand(positional[0], cacheDir);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-            std::vector<std::string> argNames;
-            size_t j = i + 4;
-            while (j < flatAST.size() && flatAST[j] && flatAST[j]->text != ")")
-            {
-                if (flatAST[j]->text != "," && !flatAST[j]->text.empty())
-                {
-                    argNames.push_back(flatAST[j]->text);
-                }
-                ++j;
-            }
+    std::unique_ptr<CompileCache> cache;
+    if (useCache)
+    {
+        cache = std::make_unique<CompileCache>(cacheDir, cacheMegabytes * 1024 * 1024);
+        options.cache = cache.get();
+    }
 
-            if (j >= flatAST.size() || flatAST[j]->text != ")")
-            {
-                std::cerr << "Warning: Missing ')' in function " << funcName << std::endl;
-                continue;
-            }
+    // Only build and run --stream have independent work to spread over threads.
+    if (jobs > 1 && command != "build" && !(command == "run" && options.streaming))
+    {
+        std::cerr << "-j only applies to 'build' and 'run --stream'." << std::endl;
+        return 1;
+    }
 
-            size_t bodyStart = j + 1;
-            while (bodyStart < flatAST.size() && flatAST[bodyStart]->text != "{")
-                ++bodyStart;
-            if (bodyStart >= flatAST.size() || flatAST[bodyStart]->text != "{")
-                continue;
-            ++bodyStart;
+    if (command == "serve" || command == "status" || command == "stop")
+    {
+        if (socketPath.empty() || !positional.empty() || options.frontend == Frontend::Compare)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        // Code generation flags come with each request.
+        if (command == "serve" && (options.memoChecks || options.elideChecks || options.nativeChecks ||
+                                   options.profileChecks || options.streaming || !options.enabledPasses.empty() ||
+                                   !options.disabledPasses.empty()))
+        {
+            std::cerr << "'serve' takes code generation flags from each request; pass them to 'run'." << std::endl;
+            return 1;
+        }
+        try
+        {
+            if (command == "serve")
+                return serve(socketPath, options);
+            return remoteCommand(socketPath, command == "status" ? "STATS" : "SHUTDOWN");
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-            std::vector<std::vector<ParseNode *>> insertBlocks;
-            for (size_t k = 0; k < argNames.size() && k < contract.argTypes.size(); ++k)
-            {
-                const Type *type = contract.argTypes[k];
-                if (!type)
-                    continue;
-                std::string typeStr = type->toString();
-                std::string checkExpr = "if (!is." + typeStr + "(" + argNames[k] + ")) stop('Argument `" + argNames[k] + "` must be of type " + typeStr + "')";
-                std::vector<ParseNode *> checkNodes = generateASTFromSource(checkExpr);
-                if (!checkNodes.empty())
-                    insertBlocks.push_back(checkNodes);
-            }
+    bool isRun = command == "run";
+    bool isBuild = command == "build";
+    bool isParse = command == "parse";
+    if ((!isRun && !isBuild && !isParse) || positional.size() != 1 || (!isParse && outputPath.empty()))
+    {
+        std::cerr << "Invalid command or output flag." << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
 
-            for (auto it = insertBlocks.rbegin(); it != insertBlocks.rend(); ++it)
-            {
-                flatAST.insert(flatAST.begin() + bodyStart, it->begin(), it->end());
-            }
-        }
+    if (!isParse && options.frontend == Frontend::Compare)
+    {
+        std::cerr << "--frontend=compare is only valid with 'parse'." << std::endl;
+        return 1;
     }
 
-    // Reassemble
-    std::vector<StatementRange> statementRanges = extractStatements(flatAST);
-    std::vector<std::string> statementStrings = getStatementStrings(flatAST, statementRanges);
-
-    std::cout << "Writing to file: " << outputPath << std::endl;
-    int fd = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-
-    for (const auto &stmt : statementStrings) {
-        std::string line = stmt;
-    
-        line = std::regex_replace(line, std::regex("^\\s+|\\s+$"), "");
-    
-        line = std::regex_replace(line, std::regex("\\}"), "\n}");
-    
-        line = std::regex_replace(line, std::regex("\\{"), "{\n");
-    
-        line = std::regex_replace(line, std::regex(";"), ";\n");
-    
-        line = std::regex_replace(line, std::regex("([a-zA-Z0-9_])\\s*\\("), "$1(");
-    
-        line = std::regex_replace(line, std::regex("\\s*=\\s*"), " = ");
-        line = std::regex_replace(line, std::regex("\\s*\\+\\s*"), " + ");
-        line = std::regex_replace(line, std::regex("\\s*<-\\s*"), " <- ");
-        line = std::regex_replace(line, std::regex("\\s*/\\s*"), " / ");
-        line = std::regex_replace(line, std::regex("\\s*\\*\\s*"), " * ");
-    
-        line = std::regex_replace(line, std::regex("\\$\\s*"), "$");
-
-        line = std::regex_replace(line, std::regex("\\s*\\)\\s*"), " ) \n");
-    
-        // Optional: indent body lines inside functions
-        if (!line.empty() && line != "{" && line != "}" && line.find("function") == std::string::npos)
-            line = "    " + line;
-    
-        line += "\n";
-        std::cout << line;
-        write(fd, line.c_str(), line.size());
+    if (options.memoChecks && !runtimeEnabled(options))
+    {
+        std::cerr << "--memo-checks requires the runtime pass." << std::endl;
+        return 1;
     }
-    
 
-    close(fd);
-    Rf_endEmbeddedR(0);
-}
+    if (options.nativeChecks && !runtimeEnabled(options))
+    {
+        std::cerr << "--native-checks requires the runtime pass." << std::endl;
+        return 1;
+    }
 
-bool fileExists(const char *path)
-{
-    struct stat buffer;
-    return stat(path, &buffer) == 0;
-}
+    if (options.profileChecks && !runtimeEnabled(options))
+    {
+        std::cerr << "--profile-checks requires the runtime pass." << std::endl;
+        return 1;
+    }
 
-int main(int argc, char *argv[])
-{
-    if (argc != 5)
+    if (options.elideChecks && !passEnabled(*findPass("verify-calls"), options))
     {
-        std::cerr << "Usage: " << argv[0] << " run <filename> -o <output path>" << std::endl;
+        std::cerr << "--elide-checks requires the verify-calls pass." << std::endl;
         return 1;
     }
 
-    const char *commandFlag = argv[1];
-    const char *filename = argv[2];
-    const char *outputFlag = argv[3];
-    const char *outputPath = argv[4];
+    if (options.streaming && (useCache || options.elideChecks))
+    {
+        std::cerr << "--stream cannot be combined with the compile cache or --elide-checks." << std::endl;
+        return 1;
+    }
 
-    if (strcmp(commandFlag, "run") != 0 || strcmp(outputFlag, "-o") != 0)
+    // Eliding needs every call site, and files of a build call each other.
+    if (isBuild && options.elideChecks)
     {
-        std::cerr << "Invalid command or output flag." << std::endl;
+        std::cerr << "--elide-checks cannot be used with 'build'." << std::endl;
         return 1;
     }
 
-    if (!fileExists(filename))
+    // Each incremental fragment would be verified as if it were the whole file.
+    if (options.incremental && options.elideChecks)
     {
-        std::cerr << "File not found: " << filename << std::endl;
+        std::cerr << "--incremental cannot be combined with --elide-checks." << std::endl;
         return 1;
     }
 
-    if (!std::getenv("R_HOME"))
+    const char *filename = positional[0].c_str();
+    if (!fileExists(filename))
     {
-        setenv("R_HOME", "/usr/lib64/R", 1);
+        std::cerr << "File not found: " << filename << std::endl;
+        return 1;
     }
 
-    int r_argc = 2;
-    char *r_argv[] = {const_cast<char *>("R"), const_cast<char *>("--silent")};
-    Rf_initEmbeddedR(r_argc, r_argv);
+    if (isRun && socketPath.empty() && std::getenv("STAR_SOCKET"))
+        socketPath = std::getenv("STAR_SOCKET");
 
     try
     {
-        run(filename, outputPath);
-        injectInputTypeChecks(outputPath);
-        generateOutputTypeChecks(outputPath);
+        if (isRun && !socketPath.empty())
+        {
+            // The daemon applies each request's code generation flags but
+            // compiles on one thread, against its own cache, and is not timed.
+            if (timings || options.passTimings || jobs > 1 || useCache)
+            {
+                std::cerr << "--timings, --pass-timings, -j and the compile cache cannot be used through the compile daemon."
+                          << std::endl;
+                return 1;
+            }
+            return runRemote(socketPath, filename, outputPath, options);
+        }
+
+        // The parse command has its own --stats.
+        if (!isParse)
+            options.timings = timings.get();
+
+        // Workers hand their R calls to this thread, which owns the session.
+        std::unique_ptr<ThreadPool> pool;
+        if (jobs > 1)
+        {
+            pool = std::make_unique<ThreadPool>(jobs);
+            options.pool = pool.get();
+        }
+
+        // The native front end never calls into R, so skip interpreter startup.
+        std::unique_ptr<RSession> session;
+        if (options.frontend != Frontend::Native)
+        {
+            std::optional<PhaseClock> clock;
+            if (options.timings)
+                clock.emplace(PhaseClock::Cpu::Process);
+            session = std::make_unique<RSession>();
+            if (options.timings)
+                options.timings->record(clock->stop("R startup"));
+        }
+
+        if (isParse)
+        {
+            if (options.frontend == Frontend::Compare)
+                return compareFrontends(filename) ? 0 : 1;
+
+            if (showStats)
+                return parseStats(filename, options.frontend);
+
+            ParseArena arena;
+            for (ParseNode *root : parseFile(filename, options.frontend, arena))
+                debugAST(root, 0);
+            return 0;
+        }
+
+        if (isBuild)
+        {
+            BuildReport report = buildProject(collectBuildUnits(filename, outputPath), options);
+            printBuildReport(report);
+            if (options.timings)
+                options.timings->print();
+            return report.failed == 0 ? 0 : 1;
+        }
+
+        bool compiled = compileFile(filename, outputPath.c_str(), options);
+        if (options.timings)
+            options.timings->print();
+        return compiled ? 0 : 1;
     }
     catch (const std::exception &e)
     {
         std::cerr << "Error: " << e.what() << std::endl;
-        Rf_endEmbeddedR(0);
         return 1;
     }
-
-    Rf_endEmbeddedR(0);
-    return 0;
 }
@@ -0,0 +1,831 @@
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "nativeparse.h"
+
+struct Token {
+    std::string kind;
+    std::string text;
+    bool newlineBefore = false;
+    int line = 1;
+    int col = 1;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+class Lexer {
+public:
+    explicit Lexer(const std::string& source) : src(source), pos(0), line(1), col(1) {}
+
+    Token next();
+
+private:
+    const std::string& src;
+    size_t pos;
+    int line;
+    int col;
+
+    char peekChar(size_t offset = 0) const {
+        return pos + offset < src.size() ? src[pos + offset] : '\0';
+    }
+    void advance(size_t n = 1);
+    bool startsWithAt(const char* s) const {
+        return src.compare(pos, std::strlen(s), s) == 0;
+    }
+
+    void lexNumber(Token& tok);
+    void lexIdentifier(Token& tok);
+    void lexString(Token& tok);
+    bool lexRawString(Token& tok);
+    void lexOperator(Token& tok);
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+static bool isIdentStart(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return std::isalpha(u) || c == '.' || u >= 0x80;
+}
+
+static bool isIdentChar(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return std::isalnum(u) || c == '.' || c == '_' || u >= 0x80;
+}
+
+static const std::unordered_map<std::string, std::string>& keywords() {
+    static const std::unordered_map<std::string, std::string> table = {
+        {"if", "IF"}, {"else", "ELSE"}, {"for", "FOR"}, {"in", "IN"},
+        {"while", "WHILE"}, {"repeat", "REPEAT"}, {"break", "BREAK"},
+        {"next", "NEXT"}, {"function", "FUNCTION"}, {"NULL", "NULL_CONST"},
+        {"TRUE", "NUM_CONST"}, {"FALSE", "NUM_CONST"}, {"NA", "NUM_CONST"},
+        {"Inf", "NUM_CONST"}, {"NaN", "NUM_CONST"}, {"NA_integer_", "NUM_CONST"},
+        {"NA_real_", "NUM_CONST"}, {"NA_character_", "NUM_CONST"},
+        {"NA_complex_", "NUM_CONST"},
+    };
+    return table;
+}
+
+void Lexer::advance(size_t n) {
+    for (size_t i = 0; i < n && pos < src.size(); ++i) {
+        if (src[pos] == '\n') {
+            ++line;
+            col = 1;
+        } else {
+            ++col;
+        }
+        ++pos;
+    }
+}
+
+void Lexer::fail(const std::string& message) const {
+    throw std::runtime_error("line " + std::to_string(line) + ":" + std::to_string(col) + ": " + message);
+}
+
+Token Lexer::next() {
+    Token tok;
+    while (pos < src.size()) {
+        char c = src[pos];
+        if (c == '\n') {
+            tok.newlineBefore = true;
+            advance();
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\f') {
+            advance();
+        } else {
+            break;
+        }
+    }
+
+    tok.line = line;
+    tok.col = col;
+    tok.begin = pos;
+    tok.end = pos;
+
+    if (pos >= src.size()) {
+        tok.kind = "END_OF_INPUT";
+        return tok;
+    }
+
+    size_t start = pos;
+    char c = src[pos];
+
+    if (c == '#') {
+        while (pos < src.size() && src[pos] != '\n')
+            advance();
+        tok.kind = "COMMENT";
+    } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+               (c == '.' && std::isdigit(static_cast<unsigned char>(peekChar(1))))) {
+        lexNumber(tok);
+    } else if ((c == 'r' || c == 'R') && (peekChar(1) == '"' || peekChar(1) == '\'') && lexRawString(tok)) {
+        // raw string consumed
+    } else if (isIdentStart(c)) {
+        lexIdentifier(tok);
+    } else if (c == '"' || c == '\'') {
+        lexString(tok);
+    } else if (c == '`') {
+        lexString(tok);
+        tok.kind = "SYMBOL";
+    } else {
+        lexOperator(tok);
+    }
+
+    tok.text = src.substr(start, pos - start);
+    tok.end = pos;
+    return tok;
+}
+
+void Lexer::lexNumber(Token& tok) {
+    tok.kind = "NUM_CONST";
+    if (peekChar() == '0' && (peekChar(1) == 'x' || peekChar(1) == 'X')) {
+        advance(2);
+        while (std::isxdigit(static_cast<unsigned char>(peekChar())) || peekChar() == '.')
+            advance();
+        if (peekChar() == 'p' || peekChar() == 'P') {
+            advance();
+            if (peekChar() == '+' || peekChar() == '-')
+                advance();
+            while (std::isdigit(static_cast<unsigned char>(peekChar())))
+                advance();
+        }
+    } else {
+        while (std::isdigit(static_cast<unsigned char>(peekChar())) || peekChar() == '.')
+            advance();
+        if (peekChar() == 'e' || peekChar() == 'E') {
+            advance();
+            if (peekChar() == '+' || peekChar() == '-')
+                advance();
+            while (std::isdigit(static_cast<unsigned char>(peekChar())))
+                advance();
+        }
+    }
+    if (peekChar() == 'L' || peekChar() == 'i')
+        advance();
+}
+
+void Lexer::lexIdentifier(Token& tok) {
+    size_t start = pos;
+    while (pos < src.size() && isIdentChar(src[pos]))
+        advance();
+
+    auto it = keywords().find(src.substr(start, pos - start));
+    tok.kind = it != keywords().end() ? it->second : "SYMBOL";
+}
+
+void Lexer::lexString(Token& tok) {
+    char quote = peekChar();
+    advance();
+    while (pos < src.size() && src[pos] != quote) {
+        if (src[pos] == '\\')
+            advance();
+        advance();
+    }
+    if (pos >= src.size())
+        fail("unterminated string");
+    advance();
+    tok.kind = "STR_CONST";
+}
+
+// r"(...)", R"--[...]--" and friends (R >= 4.0).
+bool Lexer::lexRawString(Token& tok) {
+    size_t p = pos + 2;
+    size_t dashes = 0;
+    while (p < src.size() && src[p] == '-') {
+        ++dashes;
+        ++p;
+    }
+    if (p >= src.size())
+        return false;
+
+    char open = src[p];
+    char close;
+    if (open == '(') close = ')';
+    else if (open == '[') close = ']';
+    else if (open == '{') close = '}';
+    else return false;
+
+    std::string terminator = std::string(1, close) + std::string(dashes, '-') + src[pos + 1];
+    size_t end = src.find(terminator, p + 1);
+    if (end == std::string::npos)
+        fail("unterminated raw string");
+
+    advance(end + terminator.size() - pos);
+    tok.kind = "STR_CONST";
+    return true;
+}
+
+void Lexer::lexOperator(Token& tok) {
+    struct Op {
+        const char* text;
+        const char* kind;
+    };
+    // Longest spellings first.
+    static const Op ops[] = {
+        {"<<-", "LEFT_ASSIGN"}, {"->>", "RIGHT_ASSIGN"}, {":::", "NS_GET_INT"},
+        {"<-", "LEFT_ASSIGN"}, {"<=", "LE"}, {"->", "RIGHT_ASSIGN"}, {">=", "GE"},
+        {"==", "EQ"}, {"=>", "PIPEBIND"}, {"!=", "NE"}, {"&&", "AND2"}, {"||", "OR2"},
+        {"|>", "PIPE"}, {"::", "NS_GET"}, {":=", "LEFT_ASSIGN"}, {"[[", "LBB"}, {"**", "'^'"},
+        {"<", "LT"}, {">", "GT"}, {"=", "EQ_ASSIGN"}, {"!", "'!'"}, {"&", "AND"}, {"|", "OR"},
+        {":", "':'"}, {"-", "'-'"}, {"+", "'+'"}, {"*", "'*'"}, {"/", "'/'"}, {"^", "'^'"},
+        {"~", "'~'"}, {"?", "'?'"}, {"$", "'$'"}, {"@", "'@'"}, {"(", "'('"}, {")", "')'"},
+        {"{", "'{'"}, {"}", "'}'"}, {"[", "'['"}, {"]", "']'"}, {",", "','"}, {";", "';'"},
+        {"\\", "'\\\\'"},
+    };
+
+    if (peekChar() == '%') {
+        size_t end = src.find_first_of("%\n", pos + 1);
+        if (end == std::string::npos || src[end] != '%')
+            fail("unterminated %operator%");
+        advance(end + 1 - pos);
+        tok.kind = "SPECIAL";
+        return;
+    }
+
+    for (const auto& op : ops) {
+        if (startsWithAt(op.text)) {
+            advance(std::strlen(op.text));
+            tok.kind = op.kind;
+            return;
+        }
+    }
+
+    fail(std::string("unexpected input '") + peekChar() + "'");
+}
+
+// Binding powers, loosest first, following the %left/%right table in R's gram.y.
+enum Prec {
+    PREC_HELP = 1,
+    PREC_EQ_ASSIGN,
+    PREC_LEFT_ASSIGN,
+    PREC_RIGHT_ASSIGN,
+    PREC_TILDE,
+    PREC_OR,
+    PREC_AND,
+    PREC_NOT,
+    PREC_COMPARE,
+    PREC_SUM,
+    PREC_PRODUCT,
+    PREC_SPECIAL,
+    PREC_PIPEBIND,
+    PREC_COLON,
+    PREC_UNARY,
+    PREC_POWER,
+    PREC_DOLLAR,
+    PREC_POSTFIX,
+};
+
+struct BinaryOp {
+    int prec;
+    bool rightAssoc;
+};
+
+static bool binaryOp(const std::string& kind, BinaryOp& op) {
+    static const std::unordered_map<std::string, BinaryOp> table = {
+        {"'?'", {PREC_HELP, false}},
+        {"EQ_ASSIGN", {PREC_EQ_ASSIGN, true}},
+        {"LEFT_ASSIGN", {PREC_LEFT_ASSIGN, true}},
+        {"RIGHT_ASSIGN", {PREC_RIGHT_ASSIGN, false}},
+        {"'~'", {PREC_TILDE, false}},
+        {"OR", {PREC_OR, false}}, {"OR2", {PREC_OR, false}},
+        {"AND", {PREC_AND, false}}, {"AND2", {PREC_AND, false}},
+        {"GT", {PREC_COMPARE, false}}, {"GE", {PREC_COMPARE, false}},
+        {"LT", {PREC_COMPARE, false}}, {"LE", {PREC_COMPARE, false}},
+        {"EQ", {PREC_COMPARE, false}}, {"NE", {PREC_COMPARE, false}},
+        {"'+'", {PREC_SUM, false}}, {"'-'", {PREC_SUM, false}},
+        {"'*'", {PREC_PRODUCT, false}}, {"'/'", {PREC_PRODUCT, false}},
+        {"SPECIAL", {PREC_SPECIAL, false}}, {"PIPE", {PREC_SPECIAL, false}},
+        {"PIPEBIND", {PREC_PIPEBIND, false}},
+        {"':'", {PREC_COLON, false}},
+        {"'^'", {PREC_POWER, true}},
+    };
+    auto it = table.find(kind);
+    if (it == table.end())
+        return false;
+    op = it->second;
+    return true;
+}
+
+// "name <- function(...)" and "name = function(...)" define name.
+static std::string definedFunction(const ParseNode* stmt) {
+    if (stmt->children.size() != 3)
+        return "";
+    const ParseNode* lhs = stmt->children[0];
+    const ParseNode* op = stmt->children[1];
+    const ParseNode* rhs = stmt->children[2];
+    if (op->kind != TokenKind::LeftAssign && op->kind != TokenKind::EqAssign)
+        return "";
+    if (lhs->children.size() != 1 || lhs->children[0]->kind != TokenKind::Symbol)
+        return "";
+    if (rhs->children.empty() || rhs->children[0]->kind != TokenKind::Function)
+        return "";
+    return std::string(lhs->children[0]->text);
+}
+
+class NativeParser {
+public:
+    NativeParser(const std::string& source, ParseArena& arena) : lexer(source), arena(arena) {}
+
+    std::vector<ParseNode*> parseProgram();
+
+    // When set, every top-level statement is recorded here as it is parsed.
+    std::vector<SourceChunk>* chunks = nullptr;
+
+private:
+    enum class Context { TopLevel, Brace, Paren };
+
+    struct Pending {
+        Token tok;
+        ParseNode* node;
+    };
+
+    Lexer lexer;
+    ParseArena& arena;
+    int nextId = 1;
+    std::deque<Pending> lookahead;
+    std::vector<Context> contexts{Context::TopLevel};
+    std::vector<ParseNode*> braces;
+    std::vector<ParseNode*> roots;
+    size_t lastEnd = 0;
+
+    const Pending& peek(size_t n = 0);
+    ParseNode* take();
+    ParseNode* take(const char* kind);
+    bool at(const char* kind, size_t n = 0) { return peek(n).tok.kind == kind; }
+
+    ParseNode* makeExpr(const std::vector<ParseNode*>& children, const char* token = "expr");
+    ParseNode* wrap(ParseNode* terminal);
+
+    ParseNode* parseExpr(int minPrec);
+    ParseNode* parseUnary();
+    ParseNode* parsePrimary();
+    ParseNode* parseFunction();
+    ParseNode* parseIf();
+    ParseNode* parseFor();
+    ParseNode* parseWhile();
+    ParseNode* parseBrace();
+    ParseNode* parseParen();
+    ParseNode* parseCall(ParseNode* callee, const char* open, const char* close);
+    void parseStatements(std::vector<ParseNode*>& out, const char* terminator);
+
+    bool newlineEndsExpr(const Pending& p) const {
+        return contexts.back() != Context::Paren && p.tok.newlineBefore;
+    }
+    [[noreturn]] void unexpected(const Pending& p) const;
+};
+
+const NativeParser::Pending& NativeParser::peek(size_t n) {
+    while (lookahead.size() <= n) {
+        Token tok = lexer.next();
+
+        ParseNode* node = arena.makeNode(nextId++, 0, tok.kind, tok.text);
+
+        if (tok.kind == "COMMENT") {
+            if (braces.empty()) {
+                roots.push_back(node);
+            } else {
+                braces.back()->children.push_back(node);
+            }
+            continue;
+        }
+
+        lookahead.push_back({std::move(tok), node});
+    }
+    return lookahead[n];
+}
+
+ParseNode* NativeParser::take() {
+    peek();
+    ParseNode* node = lookahead.front().node;
+    lastEnd = lookahead.front().tok.end;
+    lookahead.pop_front();
+    return node;
+}
+
+ParseNode* NativeParser::take(const char* kind) {
+    if (!at(kind))
+        unexpected(peek());
+    return take();
+}
+
+void NativeParser::unexpected(const Pending& p) const {
+    std::string what = p.tok.kind == "END_OF_INPUT" ? "end of input" : "'" + p.tok.text + "'";
+    throw std::runtime_error("line " + std::to_string(p.tok.line) + ":" + std::to_string(p.tok.col) +
+                             ": unexpected " + what);
+}
+
+ParseNode* NativeParser::makeExpr(const std::vector<ParseNode*>& children, const char* token) {
+    ParseNode* node = arena.makeNode(nextId++, 0, token);
+    node->children.reserve(children.size());
+    for (ParseNode* child : children) {
+        child->parent = node->id;
+        node->children.push_back(child);
+    }
+    return node;
+}
+
+// Like bison, R reads the lookahead before reducing a terminal to expr, so
+// the wrapper's id comes after the following token's.
+ParseNode* NativeParser::wrap(ParseNode* terminal) {
+    peek();
+    return makeExpr({terminal});
+}
+
+std::vector<ParseNode*> NativeParser::parseProgram() {
+    std::vector<ParseNode*> statements;
+    parseStatements(statements, "END_OF_INPUT");
+    for (ParseNode* stmt : statements) {
+        roots.push_back(stmt);
+    }
+
+    for (ParseNode* node : roots) {
+        if (node->kind == TokenKind::Comment)
+            continue;
+        std::vector<ParseNode*> stack{node};
+        while (!stack.empty()) {
+            ParseNode* cur = stack.back();
+            stack.pop_back();
+            std::sort(cur->children.begin(), cur->children.end(), [](ParseNode* a, ParseNode* b) {
+                return a->id < b->id;
+            });
+            for (ParseNode* child : cur->children)
+                stack.push_back(child);
+        }
+    }
+
+    std::sort(roots.begin(), roots.end(), [](ParseNode* a, ParseNode* b) {
+        return a->id < b->id;
+    });
+    return roots;
+}
+
+void NativeParser::parseStatements(std::vector<ParseNode*>& out, const char* terminator) {
+    while (true) {
+        while (at("';'")) {
+            out.push_back(take());
+            if (chunks && contexts.size() == 1 && !chunks->empty())
+                chunks->back().end = lastEnd;
+        }
+        if (at(terminator))
+            return;
+
+        size_t begin = peek().tok.begin;
+        ParseNode* stmt = parseExpr(PREC_HELP);
+        out.push_back(stmt);
+        if (chunks && contexts.size() == 1)
+            chunks->push_back({begin, lastEnd, definedFunction(stmt)});
+
+        const Pending& p = peek();
+        if (p.tok.kind != terminator && p.tok.kind != "';'" && !p.tok.newlineBefore)
+            unexpected(p);
+    }
+}
+
+ParseNode* NativeParser::parseExpr(int minPrec) {
+    ParseNode* lhs = parseUnary();
+
+    while (true) {
+        const Pending& p = peek();
+        const std::string& kind = p.tok.kind;
+        if (kind == "END_OF_INPUT" || newlineEndsExpr(p))
+            break;
+
+        if (kind == "'('") {
+            lhs = parseCall(lhs, "'('", "')'");
+            continue;
+        }
+        if (kind == "'['") {
+            lhs = parseCall(lhs, "'['", "']'");
+            continue;
+        }
+        if (kind == "LBB") {
+            lhs = parseCall(lhs, "LBB", "']'");
+            continue;
+        }
+        if (kind == "'$'" || kind == "'@'") {
+            if (PREC_DOLLAR < minPrec)
+                break;
+            ParseNode* op = take();
+            const Pending& member = peek();
+            if (member.tok.kind != "SYMBOL" && member.tok.kind != "STR_CONST" && member.tok.kind != "'('")
+                unexpected(member);
+            ParseNode* rhs;
+            if (member.tok.kind == "'('") {
+                rhs = parseParen();
+            } else {
+                rhs = take();
+                if (op->kind == TokenKind::At && rhs->kind == TokenKind::Symbol)
+                    rhs->setKind(TokenKind::Slot);
+            }
+            peek();
+            lhs = makeExpr({lhs, op, rhs});
+            continue;
+        }
+
+        BinaryOp op;
+        if (!binaryOp(kind, op) || op.prec < minPrec)
+            break;
+
+        bool isEqualAssign = kind == "EQ_ASSIGN";
+        ParseNode* opNode = take();
+        ParseNode* rhs = parseExpr(op.rightAssoc ? op.prec : op.prec + 1);
+        lhs = makeExpr({lhs, opNode, rhs}, isEqualAssign ? "equal_assign" : "expr");
+    }
+
+    return lhs;
+}
+
+ParseNode* NativeParser::parseUnary() {
+    const std::string& kind = peek().tok.kind;
+    int prec = 0;
+    if (kind == "'-'" || kind == "'+'") prec = PREC_UNARY;
+    else if (kind == "'!'") prec = PREC_NOT;
+    else if (kind == "'~'") prec = PREC_TILDE;
+    else if (kind == "'?'") prec = PREC_HELP;
+
+    if (prec == 0)
+        return parsePrimary();
+
+    ParseNode* op = take();
+    ParseNode* operand = parseExpr(prec);
+    return makeExpr({op, operand});
+}
+
+ParseNode* NativeParser::parsePrimary() {
+    const Pending& p = peek();
+    const std::string& kind = p.tok.kind;
+
+    if (kind == "SYMBOL" || kind == "STR_CONST") {
+        ParseNode* tok = take();
+        if (at("NS_GET") || at("NS_GET_INT")) {
+            tok->setKind(TokenKind::SymbolPackage);
+            ParseNode* op = take();
+            if (!at("SYMBOL") && !at("STR_CONST"))
+                unexpected(peek());
+            ParseNode* name = take();
+            peek();
+            return makeExpr({tok, op, name});
+        }
+        return wrap(tok);
+    }
+    if (kind == "NUM_CONST" || kind == "NULL_CONST" || kind == "BREAK" || kind == "NEXT")
+        return wrap(take());
+    if (kind == "FUNCTION" || kind == "'\\\\'")
+        return parseFunction();
+    if (kind == "IF")
+        return parseIf();
+    if (kind == "FOR")
+        return parseFor();
+    if (kind == "WHILE")
+        return parseWhile();
+    if (kind == "REPEAT") {
+        ParseNode* kw = take();
+        ParseNode* body = parseExpr(PREC_EQ_ASSIGN);
+        return makeExpr({kw, body});
+    }
+    if (kind == "'{'")
+        return parseBrace();
+    if (kind == "'('")
+        return parseParen();
+
+    unexpected(p);
+}
+
+ParseNode* NativeParser::parseFunction() {
+    std::vector<ParseNode*> parts{take()};
+    parts.push_back(take("'('"));
+
+    contexts.push_back(Context::Paren);
+    while (!at("')'")) {
+        if (!at("SYMBOL"))
+            unexpected(peek());
+        ParseNode* formal = take();
+        formal->setKind(TokenKind::SymbolFormals);
+        parts.push_back(formal);
+
+        if (at("EQ_ASSIGN")) {
+            ParseNode* eq = take();
+            eq->setKind(TokenKind::EqFormals);
+            parts.push_back(eq);
+            parts.push_back(parseExpr(PREC_LEFT_ASSIGN));
+        }
+
+        if (at("','")) {
+            parts.push_back(take());
+        } else if (!at("')'")) {
+            unexpected(peek());
+        }
+    }
+    contexts.pop_back();
+    parts.push_back(take("')'"));
+
+    parts.push_back(parseExpr(PREC_EQ_ASSIGN));
+    return makeExpr(parts);
+}
+
+ParseNode* NativeParser::parseIf() {
+    std::vector<ParseNode*> parts{take()};
+    parts.push_back(take("'('"));
+    contexts.push_back(Context::Paren);
+    parts.push_back(parseExpr(PREC_HELP));
+    contexts.pop_back();
+    parts.push_back(take("')'"));
+    parts.push_back(parseExpr(PREC_EQ_ASSIGN));
+
+    // A newline before 'else' ends the statement at top level only.
+    const Pending& p = peek();
+    if (p.tok.kind == "ELSE" && (contexts.back() != Context::TopLevel || !p.tok.newlineBefore)) {
+        parts.push_back(take());
+        parts.push_back(parseExpr(PREC_EQ_ASSIGN));
+    }
+    return makeExpr(parts);
+}
+
+ParseNode* NativeParser::parseFor() {
+    ParseNode* kw = take();
+    std::vector<ParseNode*> cond{take("'('")};
+    contexts.push_back(Context::Paren);
+    cond.push_back(take("SYMBOL"));
+    cond.push_back(take("IN"));
+    cond.push_back(parseExpr(PREC_HELP));
+    contexts.pop_back();
+    cond.push_back(take("')'"));
+    ParseNode* forcond = makeExpr(cond, "forcond");
+
+    ParseNode* body = parseExpr(PREC_EQ_ASSIGN);
+    return makeExpr({kw, forcond, body});
+}
+
+ParseNode* NativeParser::parseWhile() {
+    std::vector<ParseNode*> parts{take()};
+    parts.push_back(take("'('"));
+    contexts.push_back(Context::Paren);
+    parts.push_back(parseExpr(PREC_HELP));
+    contexts.pop_back();
+    parts.push_back(take("')'"));
+    parts.push_back(parseExpr(PREC_EQ_ASSIGN));
+    return makeExpr(parts);
+}
+
+ParseNode* NativeParser::parseBrace() {
+    // The block node exists before its id is known so that comments lexed
+    // inside it can be attached; it is numbered once the '}' is read.
+    ParseNode* block = arena.makeNode(0, 0, "expr");
+
+    braces.push_back(block);
+    contexts.push_back(Context::Brace);
+
+    std::vector<ParseNode*> parts{take("'{'")};
+    parseStatements(parts, "'}'");
+    parts.push_back(take("'}'"));
+
+    contexts.pop_back();
+    braces.pop_back();
+
+    peek();
+    block->id = nextId++;
+    for (ParseNode* child : block->children)
+        child->parent = block->id;
+    for (ParseNode* part : parts) {
+        part->parent = block->id;
+        block->children.push_back(part);
+    }
+    return block;
+}
+
+ParseNode* NativeParser::parseParen() {
+    std::vector<ParseNode*> parts{take("'('")};
+    contexts.push_back(Context::Paren);
+    parts.push_back(parseExpr(PREC_HELP));
+    contexts.pop_back();
+    parts.push_back(take("')'"));
+    return makeExpr(parts);
+}
+
+ParseNode* NativeParser::parseCall(ParseNode* callee, const char* open, const char* close) {
+    if (std::strcmp(open, "'('") == 0) {
+        ParseNode* name = nullptr;
+        if (callee->children.size() == 1 && callee->children[0]->kind == TokenKind::Symbol)
+            name = callee->children[0];
+        else if (callee->children.size() == 3 && callee->children[0]->kind == TokenKind::SymbolPackage)
+            name = callee->children[2];
+
+        // generateAST() gives every call symbol the same placeholder arguments.
+        if (name && name->kind == TokenKind::Symbol) {
+            name->setKind(TokenKind::SymbolFunctionCall);
+            name->addArgument("arg1");
+            name->addArgument("arg2");
+        }
+    }
+
+    std::vector<ParseNode*> parts{callee, take()};
+    contexts.push_back(Context::Paren);
+
+    while (!at(close)) {
+        if (at("','")) {
+            parts.push_back(take());
+            continue;
+        }
+
+        const std::string& kind = peek().tok.kind;
+        if ((kind == "SYMBOL" || kind == "STR_CONST" || kind == "NULL_CONST") && at("EQ_ASSIGN", 1)) {
+            ParseNode* name = take();
+            if (name->kind == TokenKind::Symbol)
+                name->setKind(TokenKind::SymbolSub);
+            ParseNode* eq = take();
+            eq->setKind(TokenKind::EqSub);
+            parts.push_back(name);
+            parts.push_back(eq);
+            if (!at("','") && !at(close))
+                parts.push_back(parseExpr(PREC_LEFT_ASSIGN));
+        } else {
+            parts.push_back(parseExpr(PREC_LEFT_ASSIGN));
+        }
+
+        if (at("','")) {
+            parts.push_back(take());
+        } else if (!at(close)) {
+            unexpected(peek());
+        }
+    }
+
+    contexts.pop_back();
+    parts.push_back(take(close));
+    if (std::strcmp(open, "LBB") == 0)
+        parts.push_back(take("']'"));
+
+    peek();
+    return makeExpr(parts);
+}
+
+std::vector<SourceChunk> splitTopLevel(const std::string& source) {
+    std::vector<SourceChunk> chunks;
+    ParseArena arena;
+    NativeParser parser(source, arena);
+    parser.chunks = &chunks;
+    parser.parseProgram();
+
+    // Widen the statements so that together they tile the whole source:
+    // each chunk takes the comments and blank lines in front of it.
+    for (size_t i = 0; i < chunks.size(); ++i)
+        chunks[i].begin = i == 0 ? 0 : chunks[i - 1].end;
+    if (!chunks.empty())
+        chunks.back().end = source.size();
+    return chunks;
+}
+
+std::vector<ParseNode*> nativeParseSource(const std::string& source, ParseArena& arena) {
+    NativeParser parser(source, arena);
+    return parser.parseProgram();
+}
+
+std::vector<ParseNode*> nativeParseFile(const char* filename, ParseArena& arena) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("Cannot open file ") + filename);
+    }
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    try {
+        return nativeParseSource(buffer.str(), arena);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string(filename) + ": " + e.what());
+    }
+}
+
+static int firstTerminal(const ParseNode* node) {
+    int first = node->children.empty() ? node->id : INT_MAX;
+    for (const ParseNode* child : node->children)
+        first = std::min(first, firstTerminal(child));
+    return first;
+}
+
+static void renderCanonical(const ParseNode* node, int depth, std::ostringstream& out) {
+    out << std::string(depth * 2, ' ') << node->token;
+    if (!node->text.empty())
+        out << " " << node->text;
+    out << "\n";
+
+    std::vector<const ParseNode*> children(node->children.begin(), node->children.end());
+    std::sort(children.begin(), children.end(), [](const ParseNode* a, const ParseNode* b) {
+        return firstTerminal(a) < firstTerminal(b);
+    });
+    for (const ParseNode* child : children)
+        renderCanonical(child, depth + 1, out);
+}
+
+std::string canonicalAST(const std::vector<ParseNode*>& roots) {
+    std::vector<const ParseNode*> ordered(roots.begin(), roots.end());
+    std::sort(ordered.begin(), ordered.end(), [](const ParseNode* a, const ParseNode* b) {
+        return firstTerminal(a) < firstTerminal(b);
+    });
+
+    std::ostringstream out;
+    for (const ParseNode* root : ordered)
+        renderCanonical(root, 0, out);
+    return out.str();
+}
@@ -0,0 +1,39 @@
+#ifndef NATIVEPARSE_H
+#define NATIVEPARSE_H
+
+#include <string>
+#include <vector>
+
+#include "parse.h"
+#include "arena.h"
+
+// Self-contained R lexer and parser. Produces the same shape of tree as
+// generateAST(getParseData(...)): terminals carry R's parse-data token names
+// (SYMBOL, SYMBOL_FUNCTION_CALL, LEFT_ASSIGN, '(' ...), every operand is
+// wrapped in an "expr" node with empty text, and ids are dense and follow
+// lexing order, so flattenAST() yields the terminals in source order.
+// The exact id numbers can differ from R's where bison reduces without
+// lookahead; compare trees with canonicalAST() rather than by id.
+//
+// Throws std::runtime_error with a line:column position on syntax errors.
+std::vector<ParseNode*> nativeParseSource(const std::string& source, ParseArena& arena);
+
+std::vector<ParseNode*> nativeParseFile(const char* filename, ParseArena& arena);
+
+// Byte range [begin, end) of one top-level expression together with the
+// comments and whitespace that precede it. definedName is set when the
+// expression assigns a function to a plain symbol.
+struct SourceChunk {
+    size_t begin;
+    size_t end;
+    std::string definedName;
+};
+
+// Splits source into chunks that concatenate back to exactly source.
+std::vector<SourceChunk> splitTopLevel(const std::string& source);
+
+// Id-independent rendering of a tree: token, text and children in source
+// order. Two front ends agree when their canonical forms are equal.
+std::string canonicalAST(const std::vector<ParseNode*>& roots);
+
+#endif
@@ -0,0 +1,198 @@
+#include <ctime>
+
+#include "parallel.h"
+
+namespace {
+
+// A call handed to the owner thread by runOnOwnerThread().
+struct OwnerCall {
+    const std::function<void()>* call;
+    std::exception_ptr error;
+    bool done = false;
+    double cpuMilliseconds = 0;   // owner thread CPU time spent running it
+};
+
+// State shared between forEach() on the owner thread and the workers.
+struct Owner {
+    std::mutex mutex;
+    std::condition_variable changed;   // a call was posted or finished, or a batch ended
+    std::deque<OwnerCall*> calls;
+    std::thread::id thread;
+    bool serving = false;
+};
+
+Owner& owner() {
+    static Owner instance;
+    return instance;
+}
+
+double threadCpuMilliseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// Total of OwnerCall::cpuMilliseconds over the calls this thread handed over.
+thread_local double handedOverCpu = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0)
+        threads = 1;
+    for (unsigned i = 0; i < threads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+bool ThreadPool::take(unsigned self, size_t& item) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.items.empty()) {
+            item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& other = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.items.empty()) {
+            item = other.items.back();
+            other.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(unsigned self) {
+    unsigned long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || batch != seen; });
+            if (stopping)
+                return;
+            seen = batch;
+        }
+
+        // A worker still draining the last batch may take an item of the
+        // next one, so the task is read per item: forEach() sets it before
+        // it queues any.
+        size_t item;
+        while (take(self, item)) {
+            const std::function<void(size_t)>* current;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                current = task;
+            }
+            try {
+                (*current)(item);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            if (remaining.fetch_sub(1) == 1) {
+                Owner& o = owner();
+                std::lock_guard<std::mutex> lock(o.mutex);
+                o.changed.notify_all();
+            }
+        }
+    }
+}
+
+void ThreadPool::forEach(size_t count, const std::function<void(size_t)>& run) {
+    if (count == 0)
+        return;
+
+    Owner& o = owner();
+    {
+        std::lock_guard<std::mutex> lock(o.mutex);
+        o.thread = std::this_thread::get_id();
+        o.serving = true;
+    }
+    remaining = count;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &run;
+        error = nullptr;
+    }
+
+    // Contiguous blocks, so that neighbouring items start on one worker
+    // and only the tail of a block is stolen.
+    size_t block = (count + queues.size() - 1) / queues.size();
+    for (size_t i = 0; i < count; ++i) {
+        Queue& queue = *queues[i / block];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.items.push_back(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++batch;
+    }
+    wake.notify_all();
+
+    std::unique_lock<std::mutex> lock(o.mutex);
+    for (;;) {
+        o.changed.wait(lock, [&] { return !o.calls.empty() || remaining == 0; });
+        if (o.calls.empty())
+            break;
+        OwnerCall* call = o.calls.front();
+        o.calls.pop_front();
+        lock.unlock();
+        double start = threadCpuMilliseconds();
+        try {
+            (*call->call)();
+        } catch (...) {
+            call->error = std::current_exception();
+        }
+        call->cpuMilliseconds = threadCpuMilliseconds() - start;
+        lock.lock();
+        call->done = true;
+        o.changed.notify_all();
+    }
+    o.serving = false;
+    lock.unlock();
+
+    std::lock_guard<std::mutex> errorLock(mutex);
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void runOnOwnerThread(const std::function<void()>& call) {
+    Owner& o = owner();
+    std::unique_lock<std::mutex> lock(o.mutex);
+    if (!o.serving || o.thread == std::this_thread::get_id()) {
+        lock.unlock();
+        call();
+        return;
+    }
+
+    OwnerCall posted{&call, nullptr};
+    o.calls.push_back(&posted);
+    o.changed.notify_all();
+    o.changed.wait(lock, [&] { return posted.done; });
+    handedOverCpu += posted.cpuMilliseconds;
+    lock.unlock();
+    if (posted.error)
+        std::rethrow_exception(posted.error);
+}
+
+double handedOverCpuMilliseconds() {
+    return handedOverCpu;
+}
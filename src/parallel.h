@@ -0,0 +1,68 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for -j. Each worker has its own queue of
+// task indices; a worker whose queue runs dry steals from the back of the
+// others', so one slow file or expression does not leave the rest idle.
+//
+// The embedded R session may only be used from the thread that created it.
+// While forEach() waits for the workers, that thread (the owner) runs the
+// R calls they hand over with runOnOwnerThread(), one at a time.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Runs task(i) for every i in [0, count) on the workers and returns
+    // when all have finished. Must be called from the owner thread, and
+    // not from a task. The first exception a task throws is rethrown.
+    void forEach(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+
+    std::mutex mutex;                 // guards the fields below
+    std::condition_variable wake;
+    const std::function<void(size_t)>* task = nullptr;
+    unsigned long batch = 0;          // bumped by every forEach()
+    bool stopping = false;
+    std::exception_ptr error;
+
+    std::atomic<size_t> remaining{0}; // tasks of this batch not yet finished
+
+    void work(unsigned self);
+    bool take(unsigned self, size_t& item);
+};
+
+// Runs call on the thread that owns the R session: directly when called
+// from it or when no forEach() is running, otherwise through the owner,
+// blocking until it has run. Exceptions are rethrown in the caller.
+void runOnOwnerThread(const std::function<void()>& call);
+
+// CPU time in ms that the owner thread has spent running the calls this
+// thread handed it with runOnOwnerThread().
+double handedOverCpuMilliseconds();
+
+#endif
@@ -12,18 +12,12 @@
 #include <functional>
 
 #include "parse.h"
+#include "arena.h"
 
 SEXP tokenizeRSource(const char* filename) {
-    int r_argc = 2;
-    char* r_argv[] = {
-        const_cast<char*>("R"),
-        const_cast<char*>("--silent")
-    };
-
     FILE* file = fopen(filename, "r");
     if (!file) {
         std::cerr << "Error: Cannot open file " << filename << std::endl;
-        Rf_endEmbeddedR(0);
         return R_NilValue;
     }
 
@@ -34,9 +28,12 @@ SEXP tokenizeRSource(const char* filename) {
     }
     fclose(file);
 
+    return tokenizeRText(source, filename);
+}
+
+SEXP parseIntoSrcfile(const std::string& source, const char* filename) {
     if (source.empty()) {
         std::cerr << "Error: File is empty." << std::endl;
-        Rf_endEmbeddedR(0);
         return R_NilValue;
     }
 
@@ -45,38 +42,112 @@ SEXP tokenizeRSource(const char* filename) {
 
     SEXP text = PROTECT(Rf_mkString(source.c_str()));
     ParseStatus status;
-    SEXP exprs = PROTECT(R_ParseVector(text, -1, &status, srcfile));
+    R_ParseVector(text, -1, &status, srcfile);
+    UNPROTECT(3);
     if (status != PARSE_OK) {
         std::cerr << "Error: Parsing failed." << std::endl;
-        UNPROTECT(4);
-        Rf_endEmbeddedR(0);
         return R_NilValue;
     }
+    return srcfile;
+}
 
-    SEXP gpdCall = PROTECT(Rf_lang2(Rf_install("getParseData"), exprs));
-    SEXP result = PROTECT(Rf_eval(gpdCall, R_GlobalEnv));
-
-    if (!Rf_inherits(result, "data.frame")) {
-        std::cerr << "Sanity check failed: result is not a data.frame!" << std::endl;
-        UNPROTECT(6); 
-        Rf_endEmbeddedR(0);
+SEXP tokenizeRText(const std::string& source, const char* filename) {
+    SEXP srcfile = PROTECT(parseIntoSrcfile(source, filename));
+    if (srcfile == R_NilValue) {
+        UNPROTECT(1);
         return R_NilValue;
     }
 
+    SEXP gpdCall = PROTECT(Rf_lang2(Rf_install("getParseData"), srcfile));
+    SEXP result = PROTECT(Rf_eval(gpdCall, R_GlobalEnv));
+
     if (result == R_NilValue) {
         std::cerr << "Error: getParseData returned NULL." << std::endl;
     } else if (!Rf_inherits(result, "data.frame")) {
         std::cerr << "Error: getParseData did not return a data.frame." << std::endl;
-    } else {
-        std::cout << "Parse data successfully returned as data.frame." << std::endl;
     }
 
-    UNPROTECT(6);
-    
+    UNPROTECT(3);
     return result;
 }
 
-std::vector<ParseNode*> generateAST(SEXP parsedData) {
+// Column layout of the integer matrix R keeps in srcfile$parseData.
+enum { PD_TERMINAL = 4, PD_TOKEN = 5, PD_ID = 6, PD_PARENT = 7, PD_ROWS = 8 };
+
+bool generateASTFromParseData(SEXP srcfile, ParseArena& arena, std::vector<ParseNode*>& roots) {
+    SEXP data = Rf_findVarInFrame(srcfile, Rf_install("parseData"));
+    if (data == R_UnboundValue || TYPEOF(data) != INTSXP)
+        return false;
+
+    SEXP tokens = Rf_getAttrib(data, Rf_install("tokens"));
+    SEXP texts = Rf_getAttrib(data, Rf_install("text"));
+    R_xlen_t count = Rf_xlength(data) / PD_ROWS;
+    if (TYPEOF(tokens) != STRSXP || TYPEOF(texts) != STRSXP ||
+        Rf_xlength(tokens) != count || Rf_xlength(texts) != count)
+        return false;
+
+    const int* columns = INTEGER(data);
+    int maxId = 0;
+    for (R_xlen_t i = 0; i < count; ++i)
+        maxId = std::max(maxId, columns[i * PD_ROWS + PD_ID]);
+
+    // Ids are small dense integers, so an id-indexed array replaces both the
+    // hash map and the sort of generateAST().
+    std::vector<ParseNode*> byId(maxId + 1, nullptr);
+    for (R_xlen_t i = 0; i < count; ++i) {
+        const int* column = columns + i * PD_ROWS;
+        const char* text = CHAR(STRING_ELT(texts, i));
+        // getParseData() recovers elided terminal text from the source;
+        // leave such files to it.
+        if (column[PD_TERMINAL] && !*text)
+            return false;
+
+        int id = column[PD_ID];
+        if (id <= 0 || byId[id])
+            return false;
+
+        ParseNode* node = arena.makeNode(id, column[PD_PARENT], CHAR(STRING_ELT(tokens, i)), text);
+        if (node->kind == TokenKind::SymbolFunctionCall) {
+            node->addArgument("arg1");
+            node->addArgument("arg2");
+        }
+        byId[id] = node;
+    }
+
+    roots.clear();
+    for (ParseNode* node : byId) {
+        if (!node)
+            continue;
+        int parent = node->parent;
+        if (parent > 0 && parent <= maxId && byId[parent]) {
+            byId[parent]->children.push_back(node);
+        } else {
+            roots.push_back(node);
+        }
+    }
+    return true;
+}
+
+std::vector<ParseNode*> parseRSource(const std::string& source, const char* filename, ParseArena& arena) {
+    SEXP srcfile = PROTECT(parseIntoSrcfile(source, filename));
+    if (srcfile == R_NilValue) {
+        UNPROTECT(1);
+        return {};
+    }
+
+    std::vector<ParseNode*> roots;
+    if (!generateASTFromParseData(srcfile, arena, roots)) {
+        SEXP gpdCall = PROTECT(Rf_lang2(Rf_install("getParseData"), srcfile));
+        SEXP parseData = PROTECT(Rf_eval(gpdCall, R_GlobalEnv));
+        roots = generateAST(parseData, arena);
+        UNPROTECT(2);
+    }
+
+    UNPROTECT(1);
+    return roots;
+}
+
+std::vector<ParseNode*> generateAST(SEXP parsedData, ParseArena& arena) {
     std::vector<ParseNode*> roots;
     std::unordered_map<int, ParseNode*> nodeMap;
 
@@ -113,13 +184,10 @@ std::vector<ParseNode*> generateAST(SEXP parsedData) {
     SEXP textCol = VECTOR_ELT(parsedData, textIndex);
 
     for (int i = 0; i < nrows; ++i) {
-        auto* node = new ParseNode;
-        node->id = INTEGER(idCol)[i];
-        node->parent = INTEGER(parentCol)[i];
-        node->token = CHAR(STRING_ELT(tokenCol, i));
-        node->text = CHAR(STRING_ELT(textCol, i));
+        ParseNode* node = arena.makeNode(INTEGER(idCol)[i], INTEGER(parentCol)[i],
+                                         CHAR(STRING_ELT(tokenCol, i)), CHAR(STRING_ELT(textCol, i)));
 
-        if (node->token == "SYMBOL_FUNCTION_CALL") {
+        if (node->kind == TokenKind::SymbolFunctionCall) {
             node->addArgument("arg1");
             node->addArgument("arg2");
         }
@@ -155,7 +223,7 @@ std::vector<ParseNode*> generateAST(SEXP parsedData) {
 void debugAST(ParseNode* node, int depth) {
     std::string indent(depth * 2, ' ');
 
-    if (node->token == "COMMENT") {
+    if (node->kind == TokenKind::Comment) {
         std::cout << indent << "[COMMENT] " << node->text << std::endl;
     } else {
         std::cout << indent << node->token << ": " << node->text << std::endl;
@@ -188,9 +256,69 @@ std::vector<ParseNode*> flattenAST(const std::vector<ParseNode*>& roots) {
         collect(root);
     }
 
-    std::sort(ordered.begin(), ordered.end(), [](ParseNode* a, ParseNode* b) {
-        return a->id < b->id;
-    });
+    // Parse-data ids are small dense integers: order them with a counting
+    // sort, unless the ids are too sparse for that to pay off.
+    int maxId = 0;
+    bool negative = false;
+    for (const ParseNode* node : ordered) {
+        maxId = std::max(maxId, node->id);
+        negative = negative || node->id < 0;
+    }
+    if (negative || static_cast<size_t>(maxId) > 4 * ordered.size() + 16) {
+        std::sort(ordered.begin(), ordered.end(), [](ParseNode* a, ParseNode* b) {
+            return a->id < b->id;
+        });
+        return ordered;
+    }
+
+    std::vector<size_t> starts(maxId + 2, 0);
+    for (const ParseNode* node : ordered)
+        ++starts[node->id + 1];
+    for (size_t i = 1; i < starts.size(); ++i)
+        starts[i] += starts[i - 1];
+
+    std::vector<ParseNode*> sorted(ordered.size());
+    for (ParseNode* node : ordered)
+        sorted[starts[node->id]++] = node;
+    return sorted;
+}
 
-    return ordered;
-}
\ No newline at end of file
+// Returns the first code token under node, flagging the first token of each
+// statement of the brace blocks below it on the way. Terminal ids follow
+// source order, so the first token is the one with the smallest id.
+static ParseNode* markStatements(ParseNode* node) {
+    if (node->children.empty())
+        return node->text.empty() || node->kind == TokenKind::Comment ? nullptr : node;
+
+    bool block = false;
+    for (const ParseNode* child : node->children)
+        block = block || child->kind == TokenKind::LeftBrace;
+
+    ParseNode* first = nullptr;
+    for (ParseNode* child : node->children) {
+        ParseNode* token = markStatements(child);
+        if (!token)
+            continue;
+        if (block && child->kind != TokenKind::LeftBrace && child->kind != TokenKind::RightBrace &&
+            child->kind != TokenKind::Semicolon)
+            token->startsStatement = true;
+        if (!first || token->id < first->id)
+            first = token;
+    }
+    return first;
+}
+
+std::vector<ParseNode*> terminalTokens(const std::vector<ParseNode*>& roots) {
+    for (ParseNode* root : roots) {
+        if (ParseNode* first = markStatements(root))
+            first->startsStatement = true;
+    }
+
+    std::vector<ParseNode*> tokens;
+    for (ParseNode* node : flattenAST(roots)) {
+        if (node->children.empty() && !node->text.empty() && node->kind != TokenKind::Comment) {
+            tokens.push_back(node);
+        }
+    }
+    return tokens;
+}
@@ -3,28 +3,70 @@
 
 #include <Rinternals.h>
 
+#undef length
+
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <iostream>
 #include <functional>
+#include <memory_resource>
+#include <string_view>
+
+#include "ast.h"
+
+class ParseArena;
 
+// Nodes are created by ParseArena::makeNode(); token and text point into the
+// arena's string pool (or at string literals) and children and arguments
+// live in the arena as well. kind is token as an enum; compare that rather
+// than the name. startsStatement is set by terminalTokens() on the first
+// token of each statement.
 struct ParseNode {
     int id;
     int parent;
-    std::string token; 
-    std::string text;
-    std::vector<ParseNode*> children;
-    std::vector<std::string> arguments;
+    TokenKind kind;
+    bool startsStatement = false;
+    std::string_view token;
+    std::string_view text;
+    std::pmr::vector<ParseNode*> children;
+    std::pmr::vector<std::string_view> arguments;
 
-    void addArgument(const std::string& arg) {
+    explicit ParseNode(std::pmr::memory_resource* resource) : children(resource), arguments(resource) {}
+
+    void addArgument(std::string_view arg) {
         arguments.push_back(arg);
     }
+
+    // Retags the node, keeping kind and token in step.
+    void setKind(TokenKind newKind) {
+        kind = newKind;
+        token = tokenName(newKind);
+    }
 };
 
 SEXP tokenizeRSource(const char* filename);
 
-std::vector<ParseNode*> generateAST(SEXP parsedData);
+// Same as tokenizeRSource() for source already in memory; filename only
+// names the srcfile.
+SEXP tokenizeRText(const std::string& source, const char* filename);
+
+std::vector<ParseNode*> generateAST(SEXP parsedData, ParseArena& arena);
+
+// Parses source with R_ParseVector against a fresh srcfile, which R fills
+// with the raw parse data. Returns the srcfile (unprotected), or R_NilValue
+// on failure.
+SEXP parseIntoSrcfile(const std::string& source, const char* filename);
+
+// Builds the tree in O(n) from the integer matrix R_ParseVector stores in
+// srcfile$parseData, skipping getParseData()'s data.frame and the sorts of
+// generateAST(). Returns false when that data is missing or incomplete.
+bool generateASTFromParseData(SEXP srcfile, ParseArena& arena, std::vector<ParseNode*>& roots);
+
+// Parses source with the embedded R parser and builds its tree, through
+// generateASTFromParseData() when possible and getParseData() otherwise.
+// Returns no roots on a parse error.
+std::vector<ParseNode*> parseRSource(const std::string& source, const char* filename, ParseArena& arena);
 
 void debugAST(ParseNode* node, int depth);
 
@@ -32,4 +74,9 @@ void walkAST(ParseNode* node, std::function<void(ParseNode*)> callback);
 
 std::vector<ParseNode*> flattenAST(const std::vector<ParseNode*>& roots);
 
+// flattenAST() without expr nodes and comments: the code tokens in source
+// order. Flags the first token of every statement, that is of every root and
+// of every expression directly inside a brace block, as startsStatement.
+std::vector<ParseNode*> terminalTokens(const std::vector<ParseNode*>& roots);
+
 #endif 
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+
+#include "pipeline.h"
+#include "gensource.h"
+#include "format.h"
+#include "typelang.h"
+#include "timings.h"
+#include "verify.h"
+
+static bool parsePass(CompilationUnit& unit, const CompileOptions& options) {
+    unit.roots = parseSource(unit.source, unit.name.c_str(), options.frontend, unit.arena);
+    if (unit.roots.empty())
+        return false;
+    unit.tree = SyntaxTree(unit.roots, unit.source);
+    unit.tokens = terminalTokens(unit.roots);
+    return true;
+}
+
+static bool contractsPass(CompilationUnit& unit, const CompileOptions&) {
+    loadContracts(unit.source);
+    return true;
+}
+
+static bool verifyCallsPass(CompilationUnit& unit, const CompileOptions& options) {
+    verifyCallSites(unit, options.elideChecks);
+    return true;
+}
+
+static bool inputChecksPass(CompilationUnit& unit, const CompileOptions& options) {
+    // The memo cache, the native library loader and the profiler live in the
+    // runtime prelude.
+    bool guarded = runtimeEnabled(options);
+    injectInputTypeChecks(unit, guarded, guarded && options.memoChecks, guarded && options.nativeChecks,
+                          guarded && options.profileChecks);
+    return true;
+}
+
+static bool outputChecksPass(CompilationUnit& unit, const CompileOptions& options) {
+    bool guarded = runtimeEnabled(options);
+    generateOutputTypeChecks(unit, guarded, guarded && options.nativeChecks, guarded && options.profileChecks);
+    return true;
+}
+
+static bool runtimePass(CompilationUnit& unit, const CompileOptions& options) {
+    insertEnforcementGuards(unit, options.runtimePrelude, options.nativeChecks, options.memoChecks, options.profileChecks);
+    return true;
+}
+
+static bool formatPass(CompilationUnit& unit, const CompileOptions&) {
+    unit.output = formatTokens(unit.tokens);
+    return true;
+}
+
+const std::vector<PassInfo>& registeredPasses() {
+    static const std::vector<PassInfo> passes = {
+        {"parse", "build the AST and token buffer with the selected front end", parsePass, true, true},
+        {"contracts", "load # @contract declarations", contractsPass, true, true},
+        {"verify-calls", "check literal arguments of contracted calls at compile time", verifyCallsPass, false, true},
+        {"input-checks", "check argument types on function entry", inputChecksPass, false, true},
+        {"output-checks", "check the value of every return()", outputChecksPass, false, true},
+        {"runtime", "run checks at the star_enforce() level; emits the runtime prelude", runtimePass, false, true},
+        {"format", "pretty print the token buffer", formatPass, true, true},
+    };
+    return passes;
+}
+
+const PassInfo* findPass(const std::string& name) {
+    for (const PassInfo& pass : registeredPasses()) {
+        if (name == pass.name)
+            return &pass;
+    }
+    return nullptr;
+}
+
+bool isKnownPass(const std::string& name) {
+    return findPass(name) != nullptr;
+}
+
+static bool listed(const std::vector<std::string>& names, const char* name) {
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+bool passEnabled(const PassInfo& pass, const CompileOptions& options) {
+    if (pass.required)
+        return true;
+    if (listed(options.disabledPasses, pass.name))
+        return false;
+    return pass.enabledByDefault || listed(options.enabledPasses, pass.name);
+}
+
+bool runtimeEnabled(const CompileOptions& options) {
+    return passEnabled(*findPass("runtime"), options);
+}
+
+bool runPasses(CompilationUnit& unit, const CompileOptions& options, std::vector<PassTiming>* timings) {
+    for (const PassInfo& pass : registeredPasses()) {
+        if (!passEnabled(pass, options))
+            continue;
+
+        std::optional<PhaseClock> clock;
+        if (timings)
+            clock.emplace();
+        bool ok = pass.run(unit, options);
+        if (ok)
+            unit.edits.apply(unit.tokens);
+        if (timings)
+            timings->push_back(clock->stop(pass.name));
+        if (!ok) {
+            std::cerr << "Error: pass '" << pass.name << "' failed on " << unit.name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string optionsFingerprint(const CompileOptions& options) {
+    std::string fingerprint = "frontend=" + std::to_string(static_cast<int>(options.frontend)) + ";passes=";
+    for (const PassInfo& pass : registeredPasses()) {
+        if (passEnabled(pass, options)) {
+            fingerprint += pass.name;
+            fingerprint += ',';
+        }
+    }
+    if (options.memoChecks)
+        fingerprint += ";memo";
+    if (options.elideChecks)
+        fingerprint += ";elide";
+    if (options.nativeChecks)
+        fingerprint += ";native";
+    if (options.profileChecks)
+        fingerprint += ";profile";
+    return fingerprint;
+}
+
+void printPassTimings(const std::vector<PassTiming>& timings) {
+    double total = 0.0;
+    for (const PassTiming& timing : timings)
+        total += timing.milliseconds;
+
+    std::cerr << std::fixed << std::setprecision(3);
+    for (const PassTiming& timing : timings) {
+        std::cerr << "  " << std::left << std::setw(16) << timing.name << std::right << std::setw(10)
+                  << timing.milliseconds << " ms" << std::endl;
+    }
+    std::cerr << "  " << std::left << std::setw(16) << "total" << std::right << std::setw(10) << total
+              << " ms" << std::endl;
+}
@@ -0,0 +1,72 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "compiler.h"
+#include "rewrite.h"
+
+// State shared by every pass of one compilation. Passes rewrite tokens in
+// place; nothing touches the disk until the caller writes output.
+struct CompilationUnit {
+    std::string name;                 // file name, used in diagnostics
+    std::string source;
+    std::vector<ParseNode*> roots;    // tree from the front end
+    SyntaxTree tree;                  // columnar copy of roots
+    std::vector<ParseNode*> tokens;   // code tokens in source order
+    EditList edits;                   // pending edits to tokens, see runPasses()
+    // Per contracted function, the arguments whose checks every call site
+    // makes redundant; set by the verify-calls pass with --elide-checks.
+    std::unordered_map<std::string, std::vector<bool>> provenArguments;
+    std::string output;               // set by the format pass
+    ParseArena arena;                 // owns roots, tokens and inserted nodes
+};
+
+typedef bool (*PassFunction)(CompilationUnit& unit, const CompileOptions& options);
+
+struct PassInfo {
+    const char* name;
+    const char* description;
+    PassFunction run;
+    bool required;          // cannot be disabled from the command line
+    bool enabledByDefault;
+};
+
+struct PassTiming {
+    std::string name;
+    double milliseconds;      // wall time
+    double cpuMilliseconds;   // CPU time of the thread that ran it
+};
+
+// The passes in pipeline order.
+const std::vector<PassInfo>& registeredPasses();
+
+// The registered pass called name, or null.
+const PassInfo* findPass(const std::string& name);
+
+bool isKnownPass(const std::string& name);
+
+bool passEnabled(const PassInfo& pass, const CompileOptions& options);
+
+// Whether checks are emitted behind enforcement guards, i.e. whether the
+// runtime pass that defines them is enabled.
+bool runtimeEnabled(const CompileOptions& options);
+
+// Runs every enabled pass in order and stops at the first one that fails.
+// Passes record token rewrites in unit.edits against the buffer they were
+// given; they are applied once the pass returns, before the next one runs.
+// Per-pass wall and CPU time, including applying its edits, is appended to
+// timings when it is non-null.
+bool runPasses(CompilationUnit& unit, const CompileOptions& options, std::vector<PassTiming>* timings);
+
+// Stable description of everything in options that changes the output:
+// the front end, the set of enabled passes and code generation flags. Part
+// of every cache key.
+std::string optionsFingerprint(const CompileOptions& options);
+
+void printPassTimings(const std::vector<PassTiming>& timings);
+
+#endif
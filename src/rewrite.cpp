@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "rewrite.h"
+
+void EditList::insert(size_t position, std::vector<ParseNode*> tokens) {
+    edits.push_back({position, position, std::move(tokens)});
+}
+
+void EditList::replace(size_t begin, size_t end, std::vector<ParseNode*> tokens) {
+    if (end < begin)
+        throw std::runtime_error("Invalid replacement range");
+    edits.push_back({begin, end, std::move(tokens)});
+}
+
+void EditList::apply(std::vector<ParseNode*>& tokens) {
+    if (edits.empty())
+        return;
+
+    // Passes mostly record edits front to back, so this is usually a no-op.
+    // At the same position, insertions go before a replacement.
+    std::stable_sort(edits.begin(), edits.end(), [](const Edit& a, const Edit& b) {
+        bool aReplaces = a.end > a.begin;
+        bool bReplaces = b.end > b.begin;
+        return a.begin < b.begin || (a.begin == b.begin && !aReplaces && bReplaces);
+    });
+
+    size_t added = 0;
+    for (const Edit& edit : edits)
+        added += edit.tokens.size();
+
+    std::vector<ParseNode*> result;
+    result.reserve(tokens.size() + added);
+
+    size_t cursor = 0;
+    for (const Edit& edit : edits) {
+        if (edit.begin < cursor || edit.end > tokens.size()) {
+            throw std::runtime_error("Conflicting edits at token " + std::to_string(edit.begin));
+        }
+        result.insert(result.end(), tokens.begin() + cursor, tokens.begin() + edit.begin);
+        result.insert(result.end(), edit.tokens.begin(), edit.tokens.end());
+        cursor = edit.end;
+    }
+    result.insert(result.end(), tokens.begin() + cursor, tokens.end());
+
+    tokens.swap(result);
+    edits.clear();
+}
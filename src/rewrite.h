@@ -0,0 +1,41 @@
+#ifndef REWRITE_H
+#define REWRITE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "parse.h"
+
+// Insertions and replacements against a token buffer. Positions always
+// refer to the buffer as it was when the edits were recorded, so a pass can
+// keep scanning with its original indices; apply() then builds the new
+// buffer in a single linear pass instead of shifting the tail once per edit.
+class EditList {
+public:
+    // Inserts tokens before position (at the end when position == size).
+    // Insertions at the same position keep the order they were recorded in
+    // and come before a replacement that starts there.
+    void insert(size_t position, std::vector<ParseNode*> tokens);
+
+    // Replaces the tokens in [begin, end).
+    void replace(size_t begin, size_t end, std::vector<ParseNode*> tokens);
+
+    bool empty() const { return edits.empty(); }
+    size_t size() const { return edits.size(); }
+
+    // Materializes the edits into tokens and clears the list. Throws
+    // std::runtime_error if two replacements overlap or an insertion falls
+    // inside a replaced range.
+    void apply(std::vector<ParseNode*>& tokens);
+
+private:
+    struct Edit {
+        size_t begin;
+        size_t end;
+        std::vector<ParseNode*> tokens;
+    };
+
+    std::vector<Edit> edits;
+};
+
+#endif
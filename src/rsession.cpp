@@ -0,0 +1,39 @@
+#include <cstdlib>
+#include <stdexcept>
+
+#include <R.h>
+#include <Rinternals.h>
+#include <Rembedded.h>
+
+#undef length
+
+#include "rsession.h"
+
+static bool sessionActive = false;
+
+RSession::RSession() {
+    if (sessionActive) {
+        throw std::runtime_error("An embedded R session is already running.");
+    }
+
+    if (!std::getenv("R_HOME")) {
+        setenv("R_HOME", "/usr/lib64/R", 1);
+    }
+
+    int r_argc = 2;
+    char* r_argv[] = {
+        const_cast<char*>("R"),
+        const_cast<char*>("--silent")
+    };
+    Rf_initEmbeddedR(r_argc, r_argv);
+    sessionActive = true;
+}
+
+RSession::~RSession() {
+    Rf_endEmbeddedR(0);
+    sessionActive = false;
+}
+
+bool RSession::active() {
+    return sessionActive;
+}
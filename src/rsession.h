@@ -0,0 +1,18 @@
+#ifndef RSESSION_H
+#define RSESSION_H
+
+// Owns the embedded R interpreter for the lifetime of the object.
+// R can only be brought up once per process, so every compilation that
+// needs the R parser shares a single session created by main().
+class RSession {
+public:
+    RSession();
+    ~RSession();
+
+    RSession(const RSession&) = delete;
+    RSession& operator=(const RSession&) = delete;
+
+    static bool active();
+};
+
+#endif
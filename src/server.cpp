@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "pipeline.h"
+#include "rsession.h"
+#include "stream.h"
+
+static const size_t MAX_PAYLOAD = size_t(1) << 30;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool readLine(int fd, std::string& line) {
+    line.clear();
+    char c;
+    while (true) {
+        ssize_t n = read(fd, &c, 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        if (c == '\n')
+            return true;
+        line += c;
+        if (line.size() > 1024)
+            return false;
+    }
+}
+
+static bool readExact(int fd, std::string& out, size_t size) {
+    out.resize(size);
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, &out[got], size - got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool sendFrame(int fd, const char* status, const std::string& payload) {
+    std::string header = std::string(status) + " " + std::to_string(payload.size()) + "\n";
+    return writeAll(fd, header.data(), header.size()) && writeAll(fd, payload.data(), payload.size());
+}
+
+static bool receiveFrame(int fd, std::string& status, std::string& payload) {
+    std::string header;
+    if (!readLine(fd, header))
+        return false;
+
+    std::istringstream iss(header);
+    size_t size = 0;
+    if (!(iss >> status >> size) || size > MAX_PAYLOAD)
+        return false;
+    return readExact(fd, payload, size);
+}
+
+static sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("Socket path too long: " + path);
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+static void addPassList(std::string& words, const char* key, const std::vector<std::string>& names) {
+    if (names.empty())
+        return;
+    words += std::string(" ") + key + "=";
+    for (size_t i = 0; i < names.size(); ++i)
+        words += (i ? "," : "") + names[i];
+}
+
+// The code generation flags of options, as the words that follow the
+// length of a COMPILE request.
+static std::string encodeOptions(const CompileOptions& options) {
+    std::string words;
+    if (options.memoChecks)
+        words += " memo";
+    if (options.elideChecks)
+        words += " elide";
+    if (options.nativeChecks)
+        words += " native";
+    if (options.profileChecks)
+        words += " profile";
+    if (options.streaming)
+        words += " stream";
+    addPassList(words, "enable", options.enabledPasses);
+    addPassList(words, "disable", options.disabledPasses);
+    return words;
+}
+
+static bool decodePassList(const std::string& list, std::vector<std::string>& names) {
+    std::istringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ',')) {
+        if (!isKnownPass(name))
+            return false;
+        names.push_back(name);
+    }
+    return true;
+}
+
+// Replaces the code generation flags of options with the words left in
+// request. Returns false on a word it does not know.
+static bool decodeOptions(std::istream& request, CompileOptions& options) {
+    options.memoChecks = options.elideChecks = options.nativeChecks = options.profileChecks = false;
+    options.streaming = false;
+    options.enabledPasses.clear();
+    options.disabledPasses.clear();
+
+    std::string word;
+    while (request >> word) {
+        bool known = true;
+        if (word == "memo")
+            options.memoChecks = true;
+        else if (word == "elide")
+            options.elideChecks = true;
+        else if (word == "native")
+            options.nativeChecks = true;
+        else if (word == "profile")
+            options.profileChecks = true;
+        else if (word == "stream")
+            options.streaming = true;
+        else if (startsWith(word, "enable="))
+            known = decodePassList(word.substr(7), options.enabledPasses);
+        else if (startsWith(word, "disable="))
+            known = decodePassList(word.substr(8), options.disabledPasses);
+        else
+            known = false;
+        if (!known)
+            return false;
+    }
+    return true;
+}
+
+struct LatencyStats {
+    std::vector<double> samples;
+    size_t failures = 0;
+
+    double percentile(double p) const {
+        if (samples.empty())
+            return 0.0;
+        std::vector<double> sorted(samples);
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+    std::string report() const {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3)
+            << "requests: " << samples.size() << " (" << failures << " failed)\n"
+            << "p50: " << percentile(0.50) << " ms\n"
+            << "p99: " << percentile(0.99) << " ms\n";
+        return out.str();
+    }
+};
+
+int serve(const std::string& socketPath, const CompileOptions& options) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Error: socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    sockaddr_un addr = socketAddress(socketPath);
+    unlink(socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener, 16) < 0) {
+        std::cerr << "Error: cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        close(listener);
+        return 1;
+    }
+
+    // No SA_RESTART: accept() must return so the loop can notice the signal.
+    struct sigaction action {};
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::unique_ptr<RSession> session;
+    if (options.frontend == Frontend::R)
+        session = std::make_unique<RSession>();
+
+    std::cerr << "star: serving on " << socketPath << std::endl;
+
+    LatencyStats stats;
+    bool shutdown = false;
+    while (!shutdown && !stopRequested) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Error: accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        std::string header;
+        while (!shutdown && readLine(client, header)) {
+            std::istringstream iss(header);
+            std::string verb;
+            iss >> verb;
+
+            if (verb == "STATS") {
+                sendFrame(client, "OK", stats.report());
+                continue;
+            }
+            if (verb == "SHUTDOWN") {
+                sendFrame(client, "OK", "");
+                shutdown = true;
+                break;
+            }
+
+            std::string frontendName;
+            size_t size = 0;
+            CompileOptions requestOptions = options;
+            if (verb != "COMPILE" || !(iss >> frontendName >> size) || size > MAX_PAYLOAD ||
+                !parseFrontend(frontendName, requestOptions.frontend) ||
+                requestOptions.frontend == Frontend::Compare || !decodeOptions(iss, requestOptions)) {
+                sendFrame(client, "ERR", "Malformed request: " + header);
+                break;
+            }
+
+            std::string source;
+            if (!readExact(client, source, size))
+                break;
+
+            // Incremental fragments would each be verified as a whole file.
+            if (requestOptions.elideChecks && requestOptions.incremental) {
+                sendFrame(client, "ERR", "--elide-checks cannot be combined with the daemon's --incremental.");
+                ++stats.failures;
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            std::string output;
+            std::string error;
+            bool ok = false;
+            try {
+                if (requestOptions.frontend == Frontend::R && !session)
+                    session = std::make_unique<RSession>();
+                if (requestOptions.streaming) {
+                    std::istringstream in(source);
+                    std::ostringstream out;
+                    ok = compileStream(in, out, requestOptions, "<source>");
+                    output = out.str();
+                } else {
+                    ok = compileSource(source, output, requestOptions);
+                }
+                if (!ok)
+                    error = "Compilation failed.";
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+
+            sendFrame(client, ok ? "OK" : "ERR", ok ? output : error);
+            stats.samples.push_back(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            if (!ok)
+                ++stats.failures;
+        }
+
+        close(client);
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    std::cerr << stats.report();
+    return 0;
+}
+
+static int connectTo(const std::string& socketPath) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+
+    sockaddr_un addr = socketAddress(socketPath);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("Cannot connect to " + socketPath + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+bool remoteCompile(const std::string& socketPath, const std::string& source, std::string& output,
+                   const CompileOptions& options) {
+    int fd = connectTo(socketPath);
+
+    std::string header = "COMPILE " + std::string(options.frontend == Frontend::Native ? "native" : "r") + " " +
+                         std::to_string(source.size()) + encodeOptions(options) + "\n";
+    std::string status;
+    bool ok = writeAll(fd, header.data(), header.size()) &&
+              writeAll(fd, source.data(), source.size()) &&
+              receiveFrame(fd, status, output);
+    close(fd);
+
+    if (!ok)
+        throw std::runtime_error("Lost connection to " + socketPath);
+    return status == "OK";
+}
+
+int remoteCommand(const std::string& socketPath, const std::string& command) {
+    int fd = connectTo(socketPath);
+
+    std::string request = command + "\n";
+    std::string status, payload;
+    bool ok = writeAll(fd, request.data(), request.size()) && receiveFrame(fd, status, payload);
+    close(fd);
+
+    if (!ok) {
+        std::cerr << "Error: no reply from " << socketPath << std::endl;
+        return 1;
+    }
+    std::cout << payload;
+    return status == "OK" ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+
+#include "compiler.h"
+
+// Compile daemon. Requests and responses share one framing on a Unix
+// domain socket:
+//
+//   COMPILE <frontend> <length> [flags]\n<source bytes>  ->  OK|ERR <length>\n<bytes>
+//   STATS\n                                              ->  OK <length>\n<report>
+//   SHUTDOWN\n                                           ->  OK 0\n
+//
+// flags are the request's code generation options: any of memo, elide,
+// native, profile and stream, and enable=<passes> and disable=<passes>
+// with comma separated pass names. Every request is compiled with its own
+// flags; the server's options only supply the compile cache.
+//
+// A connection may carry any number of requests. The server keeps one warm
+// R session for the whole process and handles requests one at a time.
+int serve(const std::string& socketPath, const CompileOptions& options);
+
+// Client side of COMPILE: sends source and the code generation options in
+// options, fills output (or the server's error message) and returns whether
+// compilation succeeded.
+bool remoteCompile(const std::string& socketPath, const std::string& source, std::string& output,
+                   const CompileOptions& options);
+
+// Sends a bare STATS or SHUTDOWN request and prints the reply.
+int remoteCommand(const std::string& socketPath, const std::string& command);
+
+#endif
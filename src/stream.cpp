@@ -0,0 +1,293 @@
+#include <cctype>
+#include <iostream>
+#include <unordered_map>
+
+#include "stream.h"
+#include "checks.h"
+#include "format.h"
+#include "parallel.h"
+#include "pipeline.h"
+
+static bool isWordChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_';
+}
+
+// Keywords that cannot end an expression.
+static bool needsMore(const std::string& word) {
+    return word == "else" || word == "repeat" || word == "function";
+}
+
+static bool isHeader(const std::string& word) {
+    return word == "function" || word == "if" || word == "for" || word == "while";
+}
+
+bool TopLevelScanner::feed(const std::string& line) {
+    auto endWord = [this] {
+        if (word.empty())
+            return;
+        pending = needsMore(word);
+        lastWord = word;
+        word.clear();
+    };
+
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (!rawClose.empty()) {
+            if (line.compare(i, rawClose.size(), rawClose) == 0) {
+                i += rawClose.size() - 1;
+                rawClose.clear();
+            }
+            continue;
+        }
+        if (quote) {
+            if (c == '\\')
+                ++i;
+            else if (c == quote)
+                quote = 0;
+            continue;
+        }
+
+        if (isWordChar(c)) {
+            word += c;
+            code = true;
+            continue;
+        }
+        if ((c == '"' || c == '\'') && (word == "r" || word == "R")) {
+            // r"(...)", R"--[...]--" and friends.
+            size_t open = line.find_first_not_of('-', i + 1);
+            if (open < line.size() && (line[open] == '(' || line[open] == '[' || line[open] == '{')) {
+                char close = line[open] == '(' ? ')' : line[open] == '[' ? ']' : '}';
+                rawClose = close + line.substr(i + 1, open - i - 1) + c;
+                word.clear();
+                pending = false;
+                i = open;
+                continue;
+            }
+        }
+        endWord();
+
+        if (c == '#')
+            break;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\f')
+            continue;
+
+        code = true;
+        std::string previous;
+        previous.swap(lastWord);
+        switch (c) {
+        case '"':
+        case '\'':
+        case '`':
+            quote = c;
+            pending = false;
+            break;
+        case '(':
+            brackets += isHeader(previous) ? 'h' : '(';
+            break;
+        case '[':
+        case '{':
+            brackets += c;
+            break;
+        case ')':
+        case ']':
+        case '}':
+            pending = !brackets.empty() && brackets.back() == 'h';
+            if (!brackets.empty())
+                brackets.pop_back();
+            break;
+        case '\\':
+            // \(x) is a function header.
+            lastWord = "function";
+            pending = true;
+            break;
+        case '%': {
+            size_t close = line.find('%', i + 1);
+            i = close == std::string::npos ? line.size() : close;
+            pending = true;
+            break;
+        }
+        case ';':
+            pending = false;
+            break;
+        default:
+            // Binary and unary operators and ',' all need a right operand.
+            pending = true;
+            break;
+        }
+    }
+    endWord();
+
+    return code && brackets.empty() && !pending && !quote && rawClose.empty();
+}
+
+void TopLevelScanner::reset() {
+    *this = TopLevelScanner();
+}
+
+// Name of the function a chunk assigns, as in "name <- function(...)", or "".
+static std::string definedFunction(const std::string& chunk) {
+    size_t i = 0;
+    while (i < chunk.size()) {
+        size_t start = chunk.find_first_not_of(" \t\r\n", i);
+        if (start == std::string::npos)
+            return "";
+        if (chunk[start] != '#') {
+            i = start;
+            break;
+        }
+        i = chunk.find('\n', start);
+        if (i == std::string::npos)
+            return "";
+    }
+
+    size_t end = i;
+    while (end < chunk.size() && isWordChar(chunk[end]))
+        ++end;
+    std::string name = chunk.substr(i, end - i);
+    size_t op = chunk.find_first_not_of(" \t", end);
+    if (name.empty() || op == std::string::npos)
+        return "";
+    if (chunk.compare(op, 2, "<-") == 0)
+        op += 2;
+    else if (chunk[op] == '=')
+        op += 1;
+    else
+        return "";
+    size_t value = chunk.find_first_not_of(" \t", op);
+    if (value == std::string::npos)
+        return "";
+    return chunk.compare(value, 8, "function") == 0 || chunk[value] == '\\' ? name : "";
+}
+
+// Name of the function a "# @contract" line declares, or "" for other lines.
+static std::string contractName(const std::string& line) {
+    if (!startsWith(line, "# @contract"))
+        return "";
+    size_t begin = line.find_first_not_of(" \t", 11);
+    if (begin == std::string::npos)
+        return "";
+    size_t end = line.find_first_of(" \t(", begin);
+    return line.substr(begin, end - begin);
+}
+
+// Blanks the contract lines in chunk that declare a function other than
+// name, keeping the line count so diagnostics keep their line numbers.
+static void dropForeignContracts(std::string& chunk, const std::string& name) {
+    size_t start = 0;
+    while (start < chunk.size()) {
+        size_t end = chunk.find('\n', start);
+        if (end == std::string::npos)
+            end = chunk.size();
+        std::string declared = contractName(chunk.substr(start, end - start));
+        if (!declared.empty() && declared != name) {
+            chunk.erase(start, end - start);
+            end = start;
+        }
+        start = end + 1;
+    }
+}
+
+namespace {
+
+// An expression ready to compile, and its output once compiled.
+struct StreamChunk {
+    std::string source;
+    std::string name;
+    std::string output;   // starts with the runtime prelude for the first contracted chunk
+    bool compiled = false;
+};
+
+} // namespace
+
+bool compileStream(std::istream& in, std::ostream& out, const CompileOptions& options, const char* name) {
+    // Each expression goes through the pipeline on its own, with the
+    // prelude written once from here.
+    CompileOptions chunkOptions = options;
+    chunkOptions.cache = nullptr;
+    chunkOptions.incremental = false;
+    chunkOptions.runtimePrelude = false;
+    chunkOptions.timings = nullptr;
+    chunkOptions.pool = nullptr;
+    bool prelude = options.runtimePrelude && runtimeEnabled(options);
+
+    // With -j, up to a few expressions per worker are read ahead and
+    // compiled together, then written in source order.
+    size_t window = options.pool ? 4 * options.pool->size() : 1;
+    std::vector<StreamChunk> batch;
+
+    auto flush = [&]() {
+        auto compile = [&](size_t i) {
+            StreamChunk& chunk = batch[i];
+            std::string compiled;
+            chunk.compiled = compileSource(chunk.source, compiled, chunkOptions, chunk.name.c_str());
+            chunk.output += compiled;
+        };
+        if (options.pool && batch.size() > 1) {
+            options.pool->forEach(batch.size(), compile);
+        } else {
+            for (size_t i = 0; i < batch.size(); ++i)
+                compile(i);
+        }
+
+        for (const StreamChunk& chunk : batch) {
+            if (!chunk.compiled)
+                return false;
+            out << chunk.output;
+        }
+        batch.clear();
+        return static_cast<bool>(out);
+    };
+
+    // Every contract seen so far; later declarations win, as in loadContracts().
+    std::unordered_map<std::string, std::string> contracts;
+    TopLevelScanner scanner;
+    std::string source;
+    std::string line;
+    size_t lineNo = 0;
+    size_t firstLine = 1;
+
+    auto add = [&]() {
+        StreamChunk chunk;
+        if (prelude && !contracts.empty()) {
+            ParseArena arena;
+            chunk.output = formatTokens(runtimePreludeTokens(options.nativeChecks, options.memoChecks, options.profileChecks, arena));
+            prelude = false;
+        }
+
+        // A contract belongs to its function's chunk only: one declared in
+        // front of another expression is moved to the function it declares.
+        std::string function = definedFunction(source);
+        dropForeignContracts(source, function);
+        auto it = contracts.find(function);
+        if (it != contracts.end() && source.find(it->second) == std::string::npos)
+            source.insert(0, it->second + "\n");
+
+        chunk.source = std::move(source);
+        chunk.name = std::string(name) + ":" + std::to_string(firstLine);
+        batch.push_back(std::move(chunk));
+        source.clear();
+        return batch.size() < window || flush();
+    };
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        source += line;
+        source += '\n';
+        std::string declared = contractName(line);
+        if (!declared.empty())
+            contracts[declared] = line.substr(0, line.find_last_not_of(" \t\r") + 1);
+        if (!scanner.feed(line))
+            continue;
+
+        if (!add())
+            return false;
+        scanner.reset();
+        firstLine = lineNo + 1;
+    }
+
+    // Trailing comments compile to nothing; an unfinished expression is
+    // left to the parser to report.
+    if (scanner.hasCode() && !add())
+        return false;
+    return flush();
+}
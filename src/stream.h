@@ -0,0 +1,49 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "compiler.h"
+
+// Finds where top-level expressions end in R source fed to it one line at
+// a time, without building a tree: it tracks strings, comments, brackets
+// and lines that cannot end an expression (a trailing operator or comma,
+// or a function, if, for or while header still waiting for its body).
+class TopLevelScanner {
+public:
+    // Scans line (without its newline). Returns true if the lines fed so
+    // far end with a complete top-level expression; comment and blank lines
+    // before any code never do.
+    bool feed(const std::string& line);
+
+    // Forget the expression just completed.
+    void reset();
+
+    // Whether the lines fed so far contain code.
+    bool hasCode() const { return code; }
+
+private:
+    std::string brackets;      // open brackets, innermost last; 'h' for a header's '('
+    char quote = 0;            // inside a string or backtick name quoted by this
+    std::string rawClose;      // inside a raw string ending with this
+    bool pending = false;      // last token needs more input
+    bool code = false;
+    std::string word;          // identifier being scanned
+    std::string lastWord;      // last complete identifier, for headers
+};
+
+// Compiles in to out one top-level expression at a time, each with the
+// comments in front of it, so that memory is bounded by the largest
+// expression rather than the file. A function's contract must come before
+// it in the file; a contract declared before an expression other than the
+// function's own is moved in front of the function, and repeated in front
+// of any later definition of it. The runtime prelude
+// is written ahead of the first expression that follows a contract. With
+// options.pool, a window of expressions compiles in parallel and is written
+// in source order. name is used in diagnostics. Returns false if an
+// expression failed to compile.
+bool compileStream(std::istream& in, std::ostream& out, const CompileOptions& options, const char* name);
+
+#endif
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include "compiler.h"
+#include "parallel.h"
+#include "timings.h"
+
+// A thread's clock includes the R calls it handed to the owner thread.
+static double cpuMilliseconds(PhaseClock::Cpu clock) {
+    struct timespec now;
+    if (clock == PhaseClock::Cpu::Process) {
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+        return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6 + handedOverCpuMilliseconds();
+}
+
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+PhaseClock::PhaseClock(Cpu clock)
+    : clock(clock), wall(std::chrono::steady_clock::now()), cpu(cpuMilliseconds(clock)) {}
+
+PassTiming PhaseClock::stop(const char* name) const {
+    double milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall).count();
+    return {name, milliseconds, cpuMilliseconds(clock) - cpu};
+}
+
+TimingReport::TimingReport(Format format) : format(format), total(PhaseClock::Cpu::Process) {}
+
+void TimingReport::record(const PassTiming& phase) {
+    phases.push_back(phase);
+}
+
+FileTimings& TimingReport::file(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, added] = byName.emplace(name, files.size());
+    if (added) {
+        files.emplace_back();
+        files.back().name = name;
+    }
+    return files[it->second];
+}
+
+std::vector<const FileTimings*> TimingReport::byFile() const {
+    std::vector<const FileTimings*> sorted;
+    for (const FileTimings& file : files)
+        sorted.push_back(&file);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const FileTimings* a, const FileTimings* b) { return a->name < b->name; });
+    return sorted;
+}
+
+void TimingReport::print() const {
+    print(std::cerr);
+}
+
+void TimingReport::print(std::ostream& out) const {
+    if (format == Format::Json)
+        printJson(out);
+    else
+        printText(out);
+}
+
+static void printPhase(std::ostream& out, const PassTiming& phase) {
+    out << "  " << std::left << std::setw(16) << phase.name << std::right << std::setw(12) << phase.milliseconds
+        << std::setw(12) << phase.cpuMilliseconds << std::endl;
+}
+
+void TimingReport::printText(std::ostream& out) const {
+    out << std::fixed << std::setprecision(3);
+    out << "  " << std::left << std::setw(16) << "phase" << std::right << std::setw(12) << "wall ms"
+        << std::setw(12) << "CPU ms" << std::endl;
+    for (const PassTiming& phase : phases)
+        printPhase(out, phase);
+
+    for (const FileTimings* record : byFile()) {
+        const FileTimings& file = *record;
+        out << file.name << ": " << file.bytesRead << " bytes read, " << file.bytesWritten << " written";
+        if (file.cached)
+            out << ", cached";
+        else
+            out << ", " << file.tokens << " tokens, " << file.nodes << " nodes, " << file.arena.bytes
+                << " arena bytes in " << file.arena.allocations << " arena allocations";
+        out << ", peak RSS " << file.peakRssKb << " KB" << std::endl;
+        for (const PassTiming& phase : file.phases)
+            printPhase(out, phase);
+    }
+
+    printPhase(out, total.stop("total"));
+    out << "  peak RSS " << peakRssKb() << " KB" << std::endl;
+}
+
+// File names are the only strings that can need escaping.
+static void printJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec
+                << std::setfill(' ');
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+static void printJsonPhases(std::ostream& out, const std::vector<PassTiming>& phases) {
+    out << "[";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        out << (i ? ", " : "") << "{\"phase\": ";
+        printJsonString(out, phases[i].name);
+        out << ", \"wall_ms\": " << phases[i].milliseconds << ", \"cpu_ms\": " << phases[i].cpuMilliseconds << "}";
+    }
+    out << "]";
+}
+
+// {"star_version": "0.1.0", "wall_ms": 812.5, "cpu_ms": 790.1, "peak_rss_kb": 91234,
+//  "phases": [{"phase": "R startup", "wall_ms": 140.2, "cpu_ms": 120.7}],
+//  "files": [{"file": "a.R", "cached": false, "bytes_read": 5120, "bytes_written": 9000,
+//             "tokens": 1300, "nodes": 2500, "arena_bytes": 262144, "arena_allocations": 5,
+//             "peak_rss_kb": 90112, "phases": [...]}]}
+void TimingReport::printJson(std::ostream& out) const {
+    PassTiming elapsed = total.stop("total");
+    out << std::fixed << std::setprecision(3);
+    out << "{\"star_version\": \"" << STAR_VERSION << "\", \"wall_ms\": " << elapsed.milliseconds
+        << ", \"cpu_ms\": " << elapsed.cpuMilliseconds << ", \"peak_rss_kb\": " << peakRssKb() << ",\n \"phases\": ";
+    printJsonPhases(out, phases);
+    out << ",\n \"files\": [";
+    std::vector<const FileTimings*> sorted = byFile();
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const FileTimings& file = *sorted[i];
+        out << (i ? ",\n  " : "\n  ") << "{\"file\": ";
+        printJsonString(out, file.name);
+        out << ", \"cached\": " << (file.cached ? "true" : "false") << ", \"bytes_read\": " << file.bytesRead
+            << ", \"bytes_written\": " << file.bytesWritten << ", \"tokens\": " << file.tokens
+            << ", \"nodes\": " << file.nodes << ", \"arena_bytes\": " << file.arena.bytes
+            << ", \"arena_allocations\": " << file.arena.allocations << ", \"peak_rss_kb\": " << file.peakRssKb
+            << ", \"phases\": ";
+        printJsonPhases(out, file.phases);
+        out << "}";
+    }
+    out << (files.empty() ? "]}" : "\n]}") << std::endl;
+}
@@ -0,0 +1,87 @@
+#ifndef TIMINGS_H
+#define TIMINGS_H
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+#include "pipeline.h"
+
+// Starts a wall and a CPU clock; stop() reads both as a PassTiming. The
+// CPU clock is the calling thread's, plus what the owner thread spent on
+// the R calls it handed over (see runOnOwnerThread()), so that phases of
+// files compiled on other threads (-j) do not count; Process reads the
+// whole process, for phases that belong to no file.
+class PhaseClock {
+public:
+    enum class Cpu { Thread, Process };
+
+    explicit PhaseClock(Cpu clock = Cpu::Thread);
+
+    PassTiming stop(const char* name) const;
+
+private:
+    Cpu clock;
+    std::chrono::steady_clock::time_point wall;
+    double cpu;  // CPU time in ms
+};
+
+// What --timings records about one compiled file. Phases are the file
+// read, the cache lookup, every pass (or the incremental compile) and the
+// write, in the order they ran.
+struct FileTimings {
+    std::string name;
+    std::vector<PassTiming> phases;
+    bool cached = false;        // the output came from the compile cache
+    size_t bytesRead = 0;
+    size_t bytesWritten = 0;
+    size_t tokens = 0;          // terminals of the parse tree
+    size_t nodes = 0;           // nodes of the parse tree
+    ArenaStats arena = {};      // ParseArena use once every pass has run
+    long peakRssKb = 0;         // process high-water mark after the file
+};
+
+// Collects timings for a run or build and prints them once it is over.
+// Compilation records into it only through CompileOptions::timings, and
+// starts no clocks without it.
+class TimingReport {
+public:
+    enum class Format { Text, Json };
+
+    explicit TimingReport(Format format);
+
+    // Process-wide phases that belong to no file, such as R startup.
+    void record(const PassTiming& phase);
+
+    // The record for the file called name, created on first use. Safe to
+    // call from several threads; each record is only filled in by the
+    // thread compiling that file.
+    FileTimings& file(const std::string& name);
+
+    // Text on stderr, or one JSON document on stderr.
+    void print() const;
+
+    void print(std::ostream& out) const;
+
+private:
+    Format format;
+    PhaseClock total;
+    std::vector<PassTiming> phases;
+    std::mutex mutex;                                  // guards files and byName
+    std::deque<FileTimings> files;                     // in the order they started
+    std::unordered_map<std::string, size_t> byName;
+
+    // files sorted by name, the order of a build without -j.
+    std::vector<const FileTimings*> byFile() const;
+    void printText(std::ostream& out) const;
+    void printJson(std::ostream& out) const;
+};
+
+long peakRssKb();
+
+#endif
@@ -1,5 +1,9 @@
 #include "typelang.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 std::string ScalarType::toString() const {
@@ -46,32 +50,177 @@ std::string EnvironmentType::toString() const {
     return "env";
 }
 
-std::string NullType::toString() const {
-    return "null";
+namespace {
+
+// Mixes value into seed, as boost::hash_combine does.
+size_t combine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Distinguishes the hashes of different kinds with the same children.
+enum HashTag : size_t { ScalarTag = 1, VectorTag, ListTag, ClassTag, NullableTag, UnionTag, FunctionTag,
+                        EnvironmentTag };
+
+struct InternTable {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Type>> owned;
+    std::unordered_map<std::string, const ScalarType*> scalars;
+    std::unordered_map<uint32_t, const VectorType*> vectors;        // by base id
+    std::unordered_map<uint32_t, const ListType*> lists;            // by element id
+    std::unordered_map<uint32_t, const NullableType*> nullables;    // by base id
+    std::unordered_map<uint64_t, const UnionType*> unions;          // by left id << 32 | right id
+    std::map<std::vector<std::string>, const ClassType*> classes;
+    std::map<std::vector<uint32_t>, const FunctionType*> functions; // by argument ids, then return id
+    const EnvironmentType* environment = nullptr;
+};
+
+InternTable& table() {
+    static InternTable instance;
+    return instance;
+}
+
+} // namespace
+
+void Types::adopt(Type* type, size_t hash) {
+    InternTable& t = table();
+    type->typeId = static_cast<uint32_t>(t.owned.size() + 1);
+    type->typeHash = hash;
+    t.owned.emplace_back(type);
+}
+
+const ScalarType* Types::scalar(const std::string& name) {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const ScalarType*& slot = t.scalars[name];
+    if (!slot) {
+        auto* type = new ScalarType(name);
+        adopt(type, combine(ScalarTag, std::hash<std::string>()(name)));
+        slot = type;
+    }
+    return slot;
+}
+
+const VectorType* Types::vector(const Type* base) {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const VectorType*& slot = t.vectors[base->id()];
+    if (!slot) {
+        auto* type = new VectorType(base);
+        adopt(type, combine(VectorTag, base->hash()));
+        slot = type;
+    }
+    return slot;
+}
+
+const ListType* Types::list(const Type* element) {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const ListType*& slot = t.lists[element->id()];
+    if (!slot) {
+        auto* type = new ListType(element);
+        adopt(type, combine(ListTag, element->hash()));
+        slot = type;
+    }
+    return slot;
+}
+
+const ClassType* Types::classes(const std::vector<std::string>& ids) {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const ClassType*& slot = t.classes[ids];
+    if (!slot) {
+        size_t hash = ClassTag;
+        for (const std::string& id : ids)
+            hash = combine(hash, std::hash<std::string>()(id));
+        auto* type = new ClassType(ids);
+        adopt(type, hash);
+        slot = type;
+    }
+    return slot;
+}
+
+const NullableType* Types::nullable(const Type* base) {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const NullableType*& slot = t.nullables[base->id()];
+    if (!slot) {
+        auto* type = new NullableType(base);
+        adopt(type, combine(NullableTag, base->hash()));
+        slot = type;
+    }
+    return slot;
+}
+
+const UnionType* Types::either(const Type* left, const Type* right) {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const UnionType*& slot = t.unions[static_cast<uint64_t>(left->id()) << 32 | right->id()];
+    if (!slot) {
+        auto* type = new UnionType(left, right);
+        adopt(type, combine(combine(UnionTag, left->hash()), right->hash()));
+        slot = type;
+    }
+    return slot;
+}
+
+const FunctionType* Types::function(const std::vector<const Type*>& arguments, const Type* returnType) {
+    std::vector<uint32_t> key;
+    key.reserve(arguments.size() + 1);
+    size_t hash = FunctionTag;
+    for (const Type* argument : arguments) {
+        key.push_back(argument->id());
+        hash = combine(hash, argument->hash());
+    }
+    key.push_back(returnType->id());
+    hash = combine(hash, returnType->hash());
+
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    const FunctionType*& slot = t.functions[key];
+    if (!slot) {
+        auto* type = new FunctionType(arguments, returnType);
+        adopt(type, hash);
+        slot = type;
+    }
+    return slot;
+}
+
+const EnvironmentType* Types::environment() {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    if (!t.environment) {
+        auto* type = new EnvironmentType();
+        adopt(type, EnvironmentTag);
+        t.environment = type;
+    }
+    return t.environment;
+}
+
+size_t Types::count() {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    return t.owned.size();
 }
 
 TypeParser::TypeParser(const std::string& input) : input(input), pos(0) {}
 
-std::unordered_map<std::string, FunctionContract> TypeParser::functionContracts;
+thread_local std::unordered_map<std::string, FunctionContract> TypeParser::functionContracts;
 
-Type* TypeParser::parseType() {
+const Type* TypeParser::parseType() {
     skipWhitespace();
-    std::cout << "[parseType] pos=" << pos 
-              << ", remaining='" << input.substr(pos, std::min<size_t>(20, input.size() - pos)) 
-              << "'\n";
 
     if (match('(')) {
-        std::vector<Type*> args = parseArgumentList();
+        std::vector<const Type*> args = parseArgumentList();
         expect(')');
         expect("->");
-        Type* ret = parseType();
-        return new FunctionType(args, ret);
+        const Type* ret = parseType();
+        return Types::function(args, ret);
     }
 
     if (consume("list<")) {
-        Type* inner = parseType();
+        const Type* inner = parseType();
         expect('>');
-        return new ListType(inner);
+        return Types::list(inner);
     }
 
     if (consume("class<")) {
@@ -81,63 +230,63 @@ Type* TypeParser::parseType() {
             ids.push_back(parseIdentifier());
         }
         expect('>');
-        return new ClassType(ids);
+        return Types::classes(ids);
     }
 
-    Type* base = new ScalarType(parseIdentifier());
+    const Type* base = Types::scalar(parseIdentifier());
 
     if (match('?')) {
-        base = new NullableType(base);
+        base = Types::nullable(base);
     }
     if (match('[')) {
         expect(']');
-        base = new VectorType(base);
+        base = Types::vector(base);
     }
 
     return parseUnion(base);
 }
 
-Type* TypeParser::parsePrimary() {
+const Type* TypeParser::parsePrimary() {
     skipWhitespace();
 
     if (match('(')) {
         auto args = parseArgumentList();
         expect("->");
-        Type* ret = parseType();
+        const Type* ret = parseType();
         expect(')');
-        return new FunctionType(args, ret);
+        return Types::function(args, ret);
     }
 
     if (consume("list<")) {
-        Type* inner = parseType();
+        const Type* inner = parseType();
         expect('>');
-        return new ListType(inner);
+        return Types::list(inner);
     }
 
     if (consume("class<")) {
         std::string name = parseIdentifier();
         expect('>');
-        return new ClassType(std::vector<std::string>{name});
+        return Types::classes(std::vector<std::string>{name});
     }
 
-    return new ScalarType(parseIdentifier());
+    return Types::scalar(parseIdentifier());
 }
 
-Type* TypeParser::parseUnion(Type* first) {
+const Type* TypeParser::parseUnion(const Type* first) {
     skipWhitespace();
     if (!match('|')) return first;
 
-    Type* left = first;
+    const Type* left = first;
     do {
-        Type* right = parseType();
-        left = new UnionType(left, right);
+        const Type* right = parseType();
+        left = Types::either(left, right);
     } while (match('|'));
 
     return left;
 }
 
-std::vector<Type*> TypeParser::parseArgumentList() {
-    std::vector<Type*> args;
+std::vector<const Type*> TypeParser::parseArgumentList() {
+    std::vector<const Type*> args;
     skipWhitespace();
     while (!peek(")")) {
         args.push_back(parseType());
@@ -193,11 +342,189 @@ bool TypeParser::peek(const std::string& s) {
     return input.substr(pos, s.size()) == s;
 }
 
-bool TypeParser::typesAreCompatible(Type* actualType, Type* expectedType) {
-    return actualType->toString() == expectedType->toString();
+namespace {
+
+// Base types and their direct supertypes.
+const std::pair<const char*, const char*> baseHierarchy[] = {
+    {"integer", "numeric"},
+    {"double", "numeric"},
+    {"dataframe", "list"},
+};
+
+// Whether is.<expected>() accepts every atomic vector of type actual.
+bool baseSubtype(const std::string& actual, const std::string& expected) {
+    if (actual == expected)
+        return true;
+    for (const auto& [type, parent] : baseHierarchy) {
+        if (actual == type && baseSubtype(parent, expected))
+            return true;
+    }
+    return false;
 }
 
-void TypeParser::addContract(const std::string& functionName, const std::vector<Type*>& argumentTypes, Type* returnType) {
+bool hasClass(const ClassType* type, const std::string& id) {
+    const std::vector<std::string>& ids = type->getClassIDs();
+    return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+void collectMembers(const Type* type, std::vector<const Type*>& members) {
+    if (type->isUnion()) {
+        const auto* both = static_cast<const UnionType*>(type);
+        collectMembers(both->getLeftType(), members);
+        collectMembers(both->getRightType(), members);
+    } else if (type->isNullable()) {
+        collectMembers(Types::scalar("null"), members);
+        collectMembers(static_cast<const NullableType*>(type)->getBaseType(), members);
+    } else if (std::find(members.begin(), members.end(), type) == members.end()) {
+        members.push_back(type);
+    }
+}
+
+// The relation for a single pair, consulting the cache for the parts.
+bool subtype(const Type* actual, const Type* expected) {
+    if (actual->isUnion() || actual->isNullable()) {
+        std::vector<const Type*> alternatives;
+        collectMembers(actual, alternatives);
+        for (const Type* member : alternatives) {
+            if (!TypeLattice::isSubtype(member, expected))
+                return false;
+        }
+        return true;
+    }
+    if (expected->isUnion() || expected->isNullable()) {
+        std::vector<const Type*> alternatives;
+        collectMembers(expected, alternatives);
+        for (const Type* member : alternatives) {
+            if (TypeLattice::isSubtype(actual, member))
+                return true;
+        }
+        return false;
+    }
+
+    const std::string* name = actual->isScalar() ? &static_cast<const ScalarType*>(actual)->getName() : nullptr;
+    // class<data.frame> and dataframe are checked by the same inherits() test.
+    if (actual->isClass() && static_cast<const ClassType*>(actual)->getClassIDs() == std::vector<std::string>{"data.frame"})
+        return TypeLattice::isSubtype(Types::scalar("dataframe"), expected);
+
+    if (expected->isVector()) {
+        // T[] accepts an atomic vector of T and a list of T elements. An
+        // atomic vector never holds NULL, so for T?[] it must be one of T.
+        const Type* base = static_cast<const VectorType*>(expected)->getBaseType();
+        if (name && TypeLattice::isAtomic(*name)) {
+            const Type* atomic = base->isNullable() ? static_cast<const NullableType*>(base)->getBaseType() : base;
+            return atomic->isScalar() && TypeLattice::isAtomic(static_cast<const ScalarType*>(atomic)->getName()) &&
+                   TypeLattice::isSubtype(actual, atomic);
+        }
+        if (actual->isVector())
+            return TypeLattice::isSubtype(static_cast<const VectorType*>(actual)->getBaseType(), base);
+        if (actual->isList())
+            return TypeLattice::isSubtype(static_cast<const ListType*>(actual)->getElementType(), base);
+        return false;
+    }
+    if (expected->isList()) {
+        return actual->isList() && TypeLattice::isSubtype(static_cast<const ListType*>(actual)->getElementType(),
+                                                          static_cast<const ListType*>(expected)->getElementType());
+    }
+    if (expected->isClass()) {
+        const auto* classes = static_cast<const ClassType*>(expected);
+        if (name)
+            return *name == "dataframe" && hasClass(classes, "data.frame");
+        if (!actual->isClass())
+            return false;
+        for (const std::string& id : static_cast<const ClassType*>(actual)->getClassIDs()) {
+            if (!hasClass(classes, id))
+                return false;
+        }
+        return true;
+    }
+    if (expected->isFunction()) {
+        if (!actual->isFunction())
+            return false;
+        const auto* given = static_cast<const FunctionType*>(actual);
+        const auto* wanted = static_cast<const FunctionType*>(expected);
+        if (given->arguments.size() != wanted->arguments.size())
+            return false;
+        for (size_t i = 0; i < given->arguments.size(); ++i) {
+            if (!TypeLattice::isSubtype(wanted->arguments[i], given->arguments[i]))
+                return false;
+        }
+        return TypeLattice::isSubtype(given->returnType, wanted->returnType);
+    }
+    if (expected->isScalar()) {
+        const std::string& wanted = static_cast<const ScalarType*>(expected)->getName();
+        if (name)
+            return baseSubtype(*name, wanted);
+        if (actual->isList())
+            return wanted == "list";
+        if (actual->isFunction())
+            return wanted == "function";
+        if (actual->isEnvironment())
+            return wanted == "environment";
+    }
+    return false;
+}
+
+struct SubtypeCache {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, bool> results; // by actual id << 32 | expected id
+};
+
+SubtypeCache& subtypeCache() {
+    static SubtypeCache instance;
+    return instance;
+}
+
+} // namespace
+
+bool TypeLattice::isSubtype(const Type* actual, const Type* expected) {
+    if (actual == expected)
+        return true;
+
+    uint64_t key = static_cast<uint64_t>(actual->id()) << 32 | expected->id();
+    SubtypeCache& cache = subtypeCache();
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.results.find(key);
+        if (it != cache.results.end())
+            return it->second;
+    }
+    // Computed unlocked: the relation recurses into this function, and two
+    // threads racing on a pair store the same answer.
+    bool result = subtype(actual, expected);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.results.emplace(key, result);
+    return result;
+}
+
+std::vector<const Type*> TypeLattice::members(const Type* type) {
+    std::vector<const Type*> all;
+    collectMembers(type, all);
+
+    // Drop members another member subsumes, keeping the first of equivalents.
+    std::vector<const Type*> result;
+    for (size_t i = 0; i < all.size(); ++i) {
+        bool subsumed = false;
+        for (size_t j = 0; j < all.size() && !subsumed; ++j) {
+            if (i != j && isSubtype(all[i], all[j]))
+                subsumed = j < i || !isSubtype(all[j], all[i]);
+        }
+        if (!subsumed)
+            result.push_back(all[i]);
+    }
+    return result;
+}
+
+bool TypeLattice::isAtomic(const std::string& name) {
+    return name == "logical" || name == "integer" || name == "double" || name == "numeric" ||
+           name == "complex" || name == "character" || name == "raw";
+}
+
+bool TypeParser::typesAreCompatible(const Type* actualType, const Type* expectedType) {
+    return TypeLattice::isSubtype(actualType, expectedType);
+}
+
+void TypeParser::addContract(const std::string& functionName, const std::vector<const Type*>& argumentTypes,
+                             const Type* returnType) {
     functionContracts[functionName] = {argumentTypes, returnType};
 }
 
@@ -209,34 +536,44 @@ void TypeParser::verifyFunctionCalls(const std::vector<ASTNode>& rootNodes) {
     for (const auto& node : rootNodes) {
         if (node.type == "function_call") {
             std::string functionName = node.name;
-            std::vector<Type*> argumentTypes = node.argumentTypes;
-
-            TypeParser::verifySingleFunctionCall(functionName, argumentTypes);
+            const std::vector<const Type*>& argumentTypes = node.argumentTypes;
+
+            auto it = functionContracts.find(functionName);
+            if (it == functionContracts.end()) {
+                std::cerr << "Warning: No contract for function: " << functionName << std::endl;
+                continue;
+            }
+            if (it->second.argTypes.size() != argumentTypes.size()) {
+                std::cerr << "Contract arity mismatch for " << functionName << ": expected "
+                          << it->second.argTypes.size() << ", got " << argumentTypes.size() << std::endl;
+                continue;
+            }
+
+            std::vector<ArgumentVerdict> verdicts = TypeParser::verifySingleFunctionCall(functionName, argumentTypes);
+            for (size_t i = 0; i < verdicts.size(); ++i) {
+                if (verdicts[i] == ArgumentVerdict::Violated) {
+                    std::cerr << "Type mismatch in " << functionName << " argument " << i << ": expected "
+                              << it->second.argTypes[i]->toString() << ", got "
+                              << argumentTypes[i]->toString() << std::endl;
+                }
+            }
         }
     }
 }
 
-void TypeParser::verifySingleFunctionCall(const std::string& functionName, const std::vector<Type*>& argumentTypes) {
+std::vector<ArgumentVerdict> TypeParser::verifySingleFunctionCall(const std::string& functionName,
+                                                                  const std::vector<const Type*>& argumentTypes) {
     auto it = functionContracts.find(functionName);
-    if (it == functionContracts.end()) {
-        std::cerr << "Warning: No contract for function: " << functionName << std::endl;
-        return;
-    }
+    if (it == functionContracts.end())
+        return {};
 
     const FunctionContract& contract = it->second;
-
-    if (contract.argTypes.size() != argumentTypes.size()) {
-        std::cerr << "Contract arity mismatch for " << functionName << ": expected "
-                  << contract.argTypes.size() << ", got " << argumentTypes.size() << std::endl;
-        return;
-    }
-
-    for (size_t i = 0; i < argumentTypes.size(); ++i) {
-        if (contract.argTypes[i]->toString() != argumentTypes[i]->toString()) {
-            std::cerr << "Type mismatch in " << functionName << " argument " << i << ": expected "
-                      << contract.argTypes[i]->toString() << ", got "
-                      << argumentTypes[i]->toString() << std::endl;
-        }
+    std::vector<ArgumentVerdict> verdicts(contract.argTypes.size(), ArgumentVerdict::Unknown);
+    for (size_t i = 0; i < verdicts.size() && i < argumentTypes.size(); ++i) {
+        if (!argumentTypes[i] || !contract.argTypes[i])
+            continue;
+        verdicts[i] = typesAreCompatible(argumentTypes[i], contract.argTypes[i]) ? ArgumentVerdict::Satisfied
+                                                                                 : ArgumentVerdict::Violated;
     }
+    return verdicts;
 }
-
@@ -1,6 +1,7 @@
 #ifndef TYPELANG_H
 #define TYPELANG_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -17,6 +18,10 @@ class NullableType;
 class UnionType;
 class EnvironmentType;
 
+// Types are interned: every structurally distinct type exists once, built
+// through the Types factory, so two types are equal exactly when they are
+// the same object. Each carries a small id and a hash computed from its
+// structure when it is interned.
 class Type {
 public:
     virtual ~Type() = default;
@@ -29,57 +34,76 @@ public:
     virtual bool isNullable() const { return false; }
     virtual bool isUnion() const { return false; }
     virtual bool isEnvironment() const { return false; }
+
+    uint32_t id() const { return typeId; }
+    size_t hash() const { return typeHash; }
+
+protected:
+    Type() = default;
+    Type(const Type&) = delete;
+    Type& operator=(const Type&) = delete;
+
+private:
+    friend class Types;
+    uint32_t typeId = 0;
+    size_t typeHash = 0;
 };
 
 class ScalarType : public Type {
 private:
+    friend class Types;
     std::string typeName;
-public:
     ScalarType(const std::string& name) : typeName(name) {}
+public:
     std::string toString() const override;
     bool isScalar() const override { return true; }
+    const std::string& getName() const { return typeName; }
 };
 
 class VectorType : public Type {
 private:
-    Type* baseType;
+    friend class Types;
+    const Type* baseType;
+    VectorType(const Type* base) : baseType(base) {}
 public:
-    VectorType(Type* base) : baseType(base) {}
     std::string toString() const override;
     bool isVector() const override { return true; }
-    Type* getBaseType() const { return baseType; }
+    const Type* getBaseType() const { return baseType; }
 };
 
 class FunctionType : public Type {
-public:
-    FunctionType(const std::vector<Type*>& args, Type* ret)
+private:
+    friend class Types;
+    FunctionType(const std::vector<const Type*>& args, const Type* ret)
         : arguments(args), returnType(ret) {}
+public:
     std::string toString() const override;
     bool isFunction() const override { return true; }
-    const std::vector<Type*>& getArguments() const { return arguments; }
-    Type* getReturnType() const { return returnType; }
+    const std::vector<const Type*>& getArguments() const { return arguments; }
+    const Type* getReturnType() const { return returnType; }
 
-	std::vector<Type*> arguments; 
-    Type* returnType;
+	const std::vector<const Type*> arguments;
+    const Type* const returnType;
 };
 
 class ListType : public Type {
 private:
-    Type* elementType;
+    friend class Types;
+    const Type* elementType;
+    ListType(const Type* elem) : elementType(elem) {}
 public:
-    ListType(Type* elem) : elementType(elem) {}
     std::string toString() const override;
     bool isList() const override { return true; }
-    Type* getElementType() const { return elementType; }
+    const Type* getElementType() const { return elementType; }
 };
 
 class ClassType : public Type {
 private:
+    friend class Types;
     std::vector<std::string> classIDs;
-
-public:
     ClassType(const std::vector<std::string>& ids) : classIDs(ids) {}
 
+public:
     std::string toString() const override;
        
 
@@ -89,69 +113,120 @@ public:
 };
 class NullableType : public Type {
 private:
-    Type* baseType;
+    friend class Types;
+    const Type* baseType;
+    NullableType(const Type* base) : baseType(base) {}
 public:
-    NullableType(Type* base) : baseType(base) {}
     std::string toString() const override;
     bool isNullable() const override { return true; }
-    Type* getBaseType() const { return baseType; }
+    const Type* getBaseType() const { return baseType; }
 };
 
 class UnionType : public Type {
 private:
-    Type* leftType;
-    Type* rightType;
+    friend class Types;
+    const Type* leftType;
+    const Type* rightType;
+    UnionType(const Type* left, const Type* right) : leftType(left), rightType(right) {}
 public:
-    UnionType(Type* left, Type* right) : leftType(left), rightType(right) {}
     std::string toString() const override;
     bool isUnion() const override { return true; }
-    Type* getLeftType() const { return leftType; }
-    Type* getRightType() const { return rightType; }
+    const Type* getLeftType() const { return leftType; }
+    const Type* getRightType() const { return rightType; }
 };
 
 class EnvironmentType : public Type {
+private:
+    friend class Types;
+    EnvironmentType() = default;
 public:
     std::string toString() const override;
     bool isEnvironment() const override { return true; }
 };
 
-class NullType : public Type {
+// The intern table. Each factory returns the canonical instance for its
+// arguments, creating it on first use; instances live until exit. Safe to
+// call from several threads.
+class Types {
 public:
-    std::string toString() const override;
+    static const ScalarType* scalar(const std::string& name);
+    static const VectorType* vector(const Type* base);
+    static const ListType* list(const Type* element);
+    static const ClassType* classes(const std::vector<std::string>& ids);
+    static const NullableType* nullable(const Type* base);
+    static const UnionType* either(const Type* left, const Type* right);
+    static const FunctionType* function(const std::vector<const Type*>& arguments, const Type* returnType);
+    static const EnvironmentType* environment();
+
+    // Number of interned types.
+    static size_t count();
+
+private:
+    // Gives a new type its id and hash and takes ownership of it.
+    static void adopt(Type* type, size_t hash);
+};
+
+// The subtyping relation: actual <: expected when every value of actual
+// passes the runtime check of expected. Base types form a small hierarchy
+// (integer and double under numeric, dataframe under list); T? is T | null;
+// unions are compared member by member after flattening; vectors and lists
+// are covariant in their elements; class<S> <: class<T> when S is a subset
+// of T. Results are cached per (actual, expected) pair, so repeated queries
+// over a whole program cost a hash lookup. Safe to call from several threads.
+class TypeLattice {
+public:
+    static bool isSubtype(const Type* actual, const Type* expected);
+
+    // The alternatives of a union or nullable type, flattened, with T? as
+    // null and T, and without members subsumed by another member; any other
+    // type is its own only member. Order follows the source.
+    static std::vector<const Type*> members(const Type* type);
+
+    // Whether is.<name>() of a whole atomic vector checks its type.
+    static bool isAtomic(const std::string& name);
 };
 
 struct FunctionContract {
-    std::vector<Type*> argTypes;
-    Type* returnType;
+    std::vector<const Type*> argTypes;
+    const Type* returnType;
 };
 
 struct ASTNode {
     std::string type;
     std::string name;
-    std::vector<Type*> argumentTypes;
+    std::vector<const Type*> argumentTypes;
 };
 
+// Outcome of checking a statically inferred argument type against a contract.
+enum class ArgumentVerdict { Unknown, Satisfied, Violated };
+
 class TypeParser {
 public:
     explicit TypeParser(const std::string& input);
-    static void addContract(const std::string& functionName, const std::vector<Type*>& argumentTypes, Type* returnType);
+    static void addContract(const std::string& functionName, const std::vector<const Type*>& argumentTypes,
+                            const Type* returnType);
 	static void addFunctionContract(const std::string& name, const FunctionContract& contract);
     static void verifyFunctionCalls(const std::vector<ASTNode>& rootNodes);
-	static bool typesAreCompatible(Type* actualType, Type* expectedType);
-	static void verifySingleFunctionCall(const std::string& functionName, const std::vector<Type*>& argumentTypes);
+	// Whether every value of actualType passes the runtime check of expectedType.
+	static bool typesAreCompatible(const Type* actualType, const Type* expectedType);
+	// One verdict per contract argument; a null or missing argument type is Unknown.
+	static std::vector<ArgumentVerdict> verifySingleFunctionCall(const std::string& functionName,
+	                                                             const std::vector<const Type*>& argumentTypes);
 	
 
-	Type* parseType();
-	std::vector<Type*> parseArgumentList();
+	const Type* parseType();
+	std::vector<const Type*> parseArgumentList();
 
-    static std::unordered_map<std::string, FunctionContract> functionContracts;
+    // Contracts of the file being compiled; one table per thread, so that
+    // files compile in parallel (see parallel.h).
+    static thread_local std::unordered_map<std::string, FunctionContract> functionContracts;
 
 private:
     std::string input;
     size_t pos;
 
-    Type* parsePrimary();
-    Type* parseUnion(Type* first);
+    const Type* parsePrimary();
+    const Type* parseUnion(const Type* first);
     std::string parseIdentifier();
     void skipWhitespace();
     bool match(char c);
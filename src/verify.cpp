@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+#include "verify.h"
+#include "gensource.h"
+#include "typelang.h"
+
+namespace {
+
+typedef std::vector<ParseNode*> Tokens;
+
+const Type* constantType(std::string_view text) {
+    if (text == "TRUE" || text == "FALSE" || text == "NA")
+        return Types::scalar("logical");
+    if (text == "NA_integer_")
+        return Types::scalar("integer");
+    if (text == "NA_character_")
+        return Types::scalar("character");
+    if (text == "NA_real_" || text == "Inf" || text == "NaN")
+        return Types::scalar("double");
+    if (!text.empty() && text.back() == 'L')
+        return Types::scalar("integer");
+    if (!text.empty() && text.back() == 'i')
+        return Types::scalar("complex");
+    return Types::scalar("double");
+}
+
+// Position of a type in c()'s coercion order, or -1 if c() cannot take it.
+int coercionRank(const Type* type) {
+    static const char* const order[] = {"null", "raw", "logical", "integer", "double", "complex", "character"};
+    if (type->isList())
+        return 7;
+    if (!type->isScalar())
+        return -1;
+    const std::string& name = static_cast<const ScalarType*>(type)->getName();
+    for (int rank = 0; rank < 7; ++rank) {
+        if (name == order[rank])
+            return rank;
+    }
+    return name == "list" || name == "dataframe" ? 7 : -1;
+}
+
+struct Argument {
+    std::string_view name; // empty when positional
+    size_t begin;          // value tokens [begin, end)
+    size_t end;
+};
+
+// Splits the arguments of the call whose '(' is tokens[open] and ')' is
+// tokens[close] at top-level commas.
+std::vector<Argument> splitArguments(const Tokens& tokens, size_t open, size_t close) {
+    std::vector<Argument> arguments;
+    if (close == open + 1)
+        return arguments;
+
+    size_t start = open + 1;
+    int depth = 0;
+    for (size_t i = open + 1; i <= close; ++i) {
+        TokenKind kind = tokens[i]->kind;
+        if (i < close && (kind == TokenKind::LeftParen || kind == TokenKind::LeftBracket ||
+                          kind == TokenKind::LeftBrace)) {
+            ++depth;
+        } else if (i < close && kind == TokenKind::Lbb) {
+            depth += 2;
+        } else if (i < close && (kind == TokenKind::RightParen || kind == TokenKind::RightBracket ||
+                                 kind == TokenKind::RightBrace)) {
+            --depth;
+        } else if (i == close || (depth == 0 && kind == TokenKind::Comma)) {
+            Argument argument{{}, start, i};
+            if (i - start >= 2 && tokens[start + 1]->kind == TokenKind::EqSub) {
+                std::string_view name = tokens[start]->text;
+                if (tokens[start]->kind == TokenKind::StrConst && name.size() >= 2)
+                    name = name.substr(1, name.size() - 2);
+                argument = {name, start + 2, i};
+            }
+            arguments.push_back(argument);
+            start = i + 1;
+        }
+    }
+    return arguments;
+}
+
+// The type of the value tokens[begin, end), or null unless it is a
+// constant, a signed number, or a c(), list() or data.frame() call on such
+// values.
+const Type* inferType(const Tokens& tokens, size_t begin, size_t end) {
+    if (begin >= end)
+        return nullptr;
+    const ParseNode* first = tokens[begin];
+
+    if (end - begin == 1) {
+        switch (first->kind) {
+        case TokenKind::NumConst: return constantType(first->text);
+        case TokenKind::StrConst: return Types::scalar("character");
+        case TokenKind::NullConst: return Types::scalar("null");
+        default: return nullptr;
+        }
+    }
+
+    if (first->kind == TokenKind::Minus || first->kind == TokenKind::Plus) {
+        const Type* operand = inferType(tokens, begin + 1, end);
+        if (!operand)
+            return nullptr;
+        if (operand == Types::scalar("logical"))
+            return Types::scalar("integer");
+        return operand == Types::scalar("integer") || operand == Types::scalar("double") ||
+               operand == Types::scalar("complex") ? operand : nullptr;
+    }
+
+    if (first->kind == TokenKind::LeftParen && matchingClose(tokens, begin) == end - 1)
+        return inferType(tokens, begin + 1, end - 1);
+
+    if (first->kind != TokenKind::SymbolFunctionCall || tokens[begin + 1]->kind != TokenKind::LeftParen ||
+        matchingClose(tokens, begin + 1) != end - 1)
+        return nullptr;
+
+    if (first->text == "data.frame")
+        return Types::scalar("dataframe");
+
+    std::vector<const Type*> elements;
+    for (const Argument& argument : splitArguments(tokens, begin + 1, end - 1)) {
+        const Type* element = inferType(tokens, argument.begin, argument.end);
+        if (!element)
+            return nullptr;
+        elements.push_back(element);
+    }
+
+    if (first->text == "list") {
+        // list() of one element type; mixed lists are only known to be lists.
+        for (const Type* element : elements) {
+            if (element != elements.front())
+                return Types::scalar("list");
+        }
+        if (elements.empty())
+            return Types::scalar("list");
+        return Types::list(elements.front());
+    }
+
+    if (first->text == "c") {
+        const Type* result = Types::scalar("null");
+        for (const Type* element : elements) {
+            int rank = coercionRank(element);
+            if (rank < 0 || rank == 7)
+                return nullptr;
+            if (rank > coercionRank(result))
+                result = element;
+        }
+        return result;
+    }
+    return nullptr;
+}
+
+struct FunctionFacts {
+    int definitions = 0;
+    int calls = 0;
+    bool escapes = false;   // used other than by name in call position
+    std::vector<std::string_view> formals;
+    std::vector<bool> proven;
+};
+
+bool namespaced(const Tokens& tokens, size_t i) {
+    if (i == 0)
+        return false;
+    TokenKind before = tokens[i - 1]->kind;
+    return before == TokenKind::Dollar || before == TokenKind::At || before == TokenKind::NsGet ||
+           before == TokenKind::NsGetInt;
+}
+
+} // namespace
+
+void verifyCallSites(CompilationUnit& unit, bool elide) {
+    const Tokens& tokens = unit.tokens;
+    const auto& contracts = TypeParser::functionContracts;
+    if (contracts.empty())
+        return;
+
+    std::unordered_map<std::string_view, FunctionFacts> facts;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (isFunctionDefinition(tokens, i) && contracts.count(std::string(tokens[i]->text))) {
+            FunctionFacts& function = facts[tokens[i]->text];
+            ++function.definitions;
+            function.formals = formalNames(tokens, i);
+            continue; // the target is not a use
+        }
+
+        std::string_view text = tokens[i]->text;
+        if (tokens[i]->kind == TokenKind::StrConst && text.size() >= 2)
+            text = text.substr(1, text.size() - 2); // do.call("f", ...)
+        else if (tokens[i]->kind != TokenKind::Symbol && tokens[i]->kind != TokenKind::SymbolFunctionCall)
+            continue;
+        if (!contracts.count(std::string(text)))
+            continue;
+        if (tokens[i]->kind != TokenKind::SymbolFunctionCall)
+            facts[text].escapes = true;
+    }
+
+    for (size_t i = 0; i + 1 < tokens.size(); ++i) {
+        if (tokens[i]->kind != TokenKind::SymbolFunctionCall || tokens[i + 1]->kind != TokenKind::LeftParen ||
+            namespaced(tokens, i))
+            continue;
+        auto factsIt = facts.find(tokens[i]->text);
+        if (factsIt == facts.end())
+            continue;
+        FunctionFacts& function = factsIt->second;
+        std::string name(tokens[i]->text);
+        const FunctionContract& contract = contracts.at(name);
+        if (function.proven.empty())
+            function.proven.assign(contract.argTypes.size(), true);
+        ++function.calls;
+
+        size_t close = matchingClose(tokens, i + 1);
+        if (close >= tokens.size()) {
+            function.escapes = true;
+            continue;
+        }
+
+        // Match arguments to formals by exact name, then by position. Calls
+        // R would match any other way are left to the runtime checks.
+        std::vector<const Type*> argumentTypes(function.formals.size(), nullptr);
+        std::vector<bool> matched(function.formals.size(), false);
+        bool matchable = std::find(function.formals.begin(), function.formals.end(), "...") == function.formals.end();
+        std::vector<Argument> arguments = splitArguments(tokens, i + 1, close);
+        for (const Argument& argument : arguments) {
+            if (argument.name.empty())
+                continue;
+            auto formal = std::find(function.formals.begin(), function.formals.end(), argument.name);
+            if (formal == function.formals.end()) {
+                matchable = false;
+                break;
+            }
+            size_t k = formal - function.formals.begin();
+            matched[k] = true;
+            argumentTypes[k] = inferType(tokens, argument.begin, argument.end);
+        }
+        size_t next = 0;
+        for (const Argument& argument : arguments) {
+            if (!matchable || !argument.name.empty())
+                continue;
+            while (next < matched.size() && matched[next])
+                ++next;
+            if (next == matched.size() || (argument.end == argument.begin + 1 && tokens[argument.begin]->text == "...")) {
+                matchable = false;
+                break;
+            }
+            matched[next] = true;
+            argumentTypes[next] = inferType(tokens, argument.begin, argument.end);
+        }
+        if (!matchable) {
+            function.proven.assign(function.proven.size(), false);
+            continue;
+        }
+
+        std::vector<ArgumentVerdict> verdicts = TypeParser::verifySingleFunctionCall(name, argumentTypes);
+        for (size_t k = 0; k < verdicts.size(); ++k) {
+            if (verdicts[k] != ArgumentVerdict::Satisfied)
+                function.proven[k] = false;
+            if (verdicts[k] == ArgumentVerdict::Violated) {
+                std::cerr << "Warning: " << unit.name << ":" << unit.tree.line(unit.tree.row(tokens[i]->id))
+                          << ": Type mismatch in call to " << name << ", argument '" << function.formals[k]
+                          << "': expected " << contract.argTypes[k]->toString() << ", got "
+                          << argumentTypes[k]->toString() << std::endl;
+            }
+        }
+    }
+
+    if (!elide)
+        return;
+    for (auto& [name, function] : facts) {
+        if (function.definitions == 1 && function.calls > 0 && !function.escapes)
+            unit.provenArguments[std::string(name)] = function.proven;
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "pipeline.h"
+
+// Infers the types of literal, c(...), list(...) and data.frame(...)
+// arguments at every call of a contracted function and checks them against
+// the contract, reporting violations on stderr with their source line.
+//
+// With elide, contract arguments that every call in the unit passes a value
+// proven to satisfy are recorded in unit.provenArguments, and their runtime
+// checks are not emitted. A function only qualifies when it is defined once,
+// called at least once and never referred to other than by name in call
+// position, so that no call can bypass the ones seen here. Calls from other
+// files are not seen at all: eliding assumes the unit is the whole program,
+// which is why build rejects it.
+void verifyCallSites(CompilationUnit& unit, bool elide);
+
+#endif
@@ -0,0 +1,41 @@
+// Formatter regressions: each source is parsed with the native front end,
+// formatted and compared with the expected output.
+//
+//   ctest, or ./format_test
+
+#include <iostream>
+#include <string>
+
+#include "arena.h"
+#include "format.h"
+#include "nativeparse.h"
+
+struct FormatCase {
+    const char* name;
+    const char* source;
+    const char* expected;
+};
+
+// Statements that start with a token that could also continue the previous
+// line must stay separate statements.
+static const FormatCase cases[] = {
+    {"parenthesized statement", "y <- 2\n(x <- 5)\n", "y <- 2\n(x <- 5)\n"},
+    {"negated statement", "z <- 1\n-z\n", "z <- 1\n-z\n"},
+    {"parenthesized statement in a block", "f <- function(a) {\n  b <- a\n  (b)\n}\n",
+     "f <- function(a)\n{\n    b <- a\n    (b)\n}\n"},
+};
+
+int main() {
+    int failures = 0;
+    for (const FormatCase& test : cases) {
+        ParseArena arena;
+        std::string output = formatTokens(terminalTokens(nativeParseSource(test.source, arena)));
+        if (output != test.expected) {
+            std::cerr << "FAIL " << test.name << "\n--- expected\n" << test.expected << "--- got\n" << output;
+            ++failures;
+        }
+    }
+    std::cout << (sizeof(cases) / sizeof(cases[0]) - failures) << " of " << sizeof(cases) / sizeof(cases[0])
+              << " format tests passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
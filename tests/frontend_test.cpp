@@ -0,0 +1,63 @@
+// Differential test of the two front ends: synthetic corpora from
+// bench/corpus.h at every complexity level, and each R file named on the
+// command line, must parse to the same tree with R's parser and with the
+// native one. Needs R.
+//
+//   ctest, or ./frontend_test file.R ...
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "compiler.h"
+#include "corpus.h"
+#include "rsession.h"
+
+static bool compareCorpus(const CorpusOptions& options) {
+    char path[] = "/tmp/star_frontend_XXXXXX.R";
+    int fd = mkstemps(path, 2);
+    if (fd < 0) {
+        std::cerr << "Error: cannot create a temporary file" << std::endl;
+        return false;
+    }
+    close(fd);
+    {
+        std::ofstream out(path, std::ios::binary);
+        writeCorpus(out, options);
+    }
+    bool agree = compareFrontends(path);
+    std::remove(path);
+    return agree;
+}
+
+int main(int argc, char* argv[]) {
+    RSession session;
+
+    int tests = 0;
+    int failures = 0;
+    for (int complexity = 0; complexity <= 3; ++complexity) {
+        CorpusOptions options;
+        options.seed = complexity + 1;
+        options.size = 64 << 10;
+        options.complexity = complexity;
+        options.depth = complexity + 1;
+        options.comments = 0.3;
+        ++tests;
+        if (!compareCorpus(options)) {
+            std::cerr << "FAIL corpus with complexity " << complexity << std::endl;
+            ++failures;
+        }
+    }
+    for (int i = 1; i < argc; ++i) {
+        ++tests;
+        if (!compareFrontends(argv[i])) {
+            std::cerr << "FAIL " << argv[i] << std::endl;
+            ++failures;
+        }
+    }
+    std::cout << tests - failures << " of " << tests << " front end comparisons agreed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
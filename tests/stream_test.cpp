@@ -0,0 +1,61 @@
+// TopLevelScanner regressions: each case feeds its lines one at a time and
+// compares where the scanner reports a complete top-level expression.
+//
+//   ctest, or ./stream_test
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "stream.h"
+
+struct ScanCase {
+    const char* name;
+    const char* source;
+    const char* ends;   // per line: 'y' if the expression is complete after it, '.' if not
+};
+
+static const ScanCase cases[] = {
+    {"assignment", "x <- 1\n", "y"},
+    {"comment before code", "# note\n\nx <- 1\n", "..y"},
+    {"trailing operator", "x <- 1 +\n  2\n", ".y"},
+    {"trailing comma", "f(1,\n  2)\n", ".y"},
+    {"open bracket in a comment", "x <- 1 # (\n", "y"},
+    {"function header", "f <- function(x)\n{\n  x\n}\n", "...y"},
+    {"function header with body on the same line", "f <- function(x) x\n", "y"},
+    {"lambda header", "f <- \\(x)\n  x + 1\n", ".y"},
+    {"if header", "if (a)\n  b\n", ".y"},
+    {"else on a line of its own", "if (a) {\n  b\n} else\n  c\n", "...y"},
+    {"bracket in a string", "x <- \"((\"\n", "y"},
+    {"escaped quote", "x <- \"a\\\"(\"\n", "y"},
+    {"string across lines", "x <- \"a\nb\"\n", ".y"},
+    {"backtick name", "`my var` <- 1\n", "y"},
+    {"raw string", "x <- r\"-(a )\" b)-\"\n", "y"},
+    {"raw string across lines", "x <- r\"(\n)\"\n", ".y"},
+    {"infix operator", "x %in% y\n", "y"},
+    {"trailing infix operator", "x %in%\n  y\n", ".y"},
+    {"semicolon", "x <- 1; y <- 2\n", "y"},
+};
+
+int main() {
+    int failures = 0;
+    for (const ScanCase& test : cases) {
+        TopLevelScanner scanner;
+        std::istringstream in(test.source);
+        std::string line;
+        std::string ends;
+        while (std::getline(in, line)) {
+            bool complete = scanner.feed(line);
+            ends += complete ? 'y' : '.';
+            if (complete)
+                scanner.reset();
+        }
+        if (ends != test.ends) {
+            std::cerr << "FAIL " << test.name << ": expected " << test.ends << ", got " << ends << std::endl;
+            ++failures;
+        }
+    }
+    std::cout << (sizeof(cases) / sizeof(cases[0]) - failures) << " of " << sizeof(cases) / sizeof(cases[0])
+              << " scanner tests passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+// Check elision: an argument that every call site provably satisfies loses
+// its runtime check, and one of a function that escapes keeps it.
+//
+//   ctest, or ./verify_test
+
+#include <iostream>
+#include <string>
+
+#include "compiler.h"
+
+struct ElisionCase {
+    const char* name;
+    const char* source;
+    const char* check;   // the argument check in question
+    bool elided;
+};
+
+static const char* const functions = "# @contract f (integer) -> integer\n"
+                                     "f <- function(x) {\n  return(x + 1L)\n}\n"
+                                     "# @contract g (integer) -> integer\n"
+                                     "g <- function(y) {\n  return(y * 2L)\n}\n";
+
+static const ElisionCase cases[] = {
+    {"proven call site", "f(1L)\ng(2L)\n", "stopifnot(is.integer(x))", true},
+    {"unproven call site", "f(1L)\ng(2.5)\n", "stopifnot(is.integer(y))", false},
+    {"function passed to lapply", "f(1L)\ng(2L)\nlapply(1:3, g)\n", "stopifnot(is.integer(y))", false},
+    {"function never called", "f(1L)\n", "stopifnot(is.integer(y))", false},
+};
+
+int main() {
+    CompileOptions options;
+    options.frontend = Frontend::Native;
+    options.elideChecks = true;
+    options.disabledPasses = {"runtime"};
+
+    int failures = 0;
+    for (const ElisionCase& test : cases) {
+        std::string output;
+        // verify-calls warns about the unproven call on stderr.
+        bool compiled = compileSource(std::string(functions) + test.source, output, options, test.name);
+        bool elided = output.find(test.check) == std::string::npos;
+        if (!compiled || elided != test.elided) {
+            std::cerr << "FAIL " << test.name << ": " << test.check << (test.elided ? " kept" : " elided")
+                      << "\n--- got\n" << output;
+            ++failures;
+        }
+    }
+    std::cout << (sizeof(cases) / sizeof(cases[0]) - failures) << " of " << sizeof(cases) / sizeof(cases[0])
+              << " elision tests passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}